@@ -2,193 +2,1023 @@
 #include <fstream>
 #include <vector>
 #include <string>
-#include <cstdlib>      // For rand() and srand() functions
-#include <ctime>        // For time() function to seed srand()
+#include <cstdlib>      // For std::atoi(), std::atof() and std::strtoull()
+#include <cstdio>       // For std::remove()
 #include <sstream>      // For stringstream operations
 #include <algorithm>    // For algorithms like std::swap
 #include <unordered_map> // For unordered_map container
+#include <unordered_set> // For dropping files a batch names twice
+#include <stdexcept>    // For std::runtime_error
+#include <cstring>      // For std::memcpy
+#include <chrono>       // For timing benchmarks
+#include <random>       // For benchmark data over wide value ranges
+#include <iomanip>      // For formatting benchmark tables
+#include <cstdint>      // For fixed-width integer types
+#include <climits>      // For INT_MIN and INT_MAX
+#include <thread>       // For worker threads
+#include <mutex>        // For std::mutex and std::call_once
+#include <condition_variable>   // For waking idle worker threads
+#include <functional>   // For std::function tasks
+#include <queue>        // For the task queue
+#include <cmath>        // For the logarithms and exponentials of the Zipf sampler
+#include <memory>       // For std::unique_ptr results and writers
+#include <atomic>       // For handing out batch files to workers
+#include <new>          // For std::bad_alloc in the counting operator new of COUNT_ALLOCATIONS builds
+#include <exception>    // For std::exception_ptr carried out of worker threads
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>  // For _mm_prefetch()
+#include <intrin.h>     // For __cpuid() and _xgetbv()
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86
+#include <immintrin.h>  // For AVX2 and AVX-512 intrinsics
+#endif
+
+// Let GCC and Clang compile a function for an instruction set the rest of the program does not assume
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+// Keep a function out of line
+#if defined(__GNUC__) || defined(__clang__)
+#define NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>    // For CreateFileMapping() and MapViewOfFile()
+#include <io.h>         // For _setmode()
+#include <fcntl.h>      // For _O_BINARY
+#else
+#include <fcntl.h>      // For open()
+#include <sys/mman.h>   // For mmap() and munmap()
+#include <sys/stat.h>   // For fstat()
+#include <unistd.h>     // For close()
+#include <dirent.h>     // For opendir() and readdir()
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>   // For perf_event_attr and the hardware event numbers
+#include <sys/syscall.h>        // For syscall() and SYS_perf_event_open
+#endif
 
 const int SIZE = 1000;  // Constant size for array and file operations
+const int DOMAIN_SIZE = 1000;   // Generated values lie in [0, DOMAIN_SIZE)
+const int DEFAULT_BLOCK_MIB = 4;    // Default block size in MiB when streaming
+const int INSERTION_SORT_MAX_SIZE = 64;         // Arrays up to this size use insertion sort
+const long long COUNTING_SORT_MAX_RANGE = 1 << 24;  // Largest value range counting sort will allocate for
+const size_t HISTOGRAM_MAX_BUCKETS = 1 << 26;   // Default largest value range a histogram counts in a flat array
+const size_t MISSING_RANGES_SHOWN = 10;         // Most missing ranges listed in a result
+const int SEARCH_PROBES = 100;  // Default number of random values searched for
+const size_t SEARCH_BATCH_WIDTH = 16;   // Searches advanced together so their memory accesses overlap
+const int PARALLEL_MIN_PARTITION = 1 << 16;    // Fewest values worth handing to a thread of their own
+const char FILE_MAGIC[4] = { 'B', 'D', 'A', 'T' };  // First bytes of a version 2 data file
+const uint32_t FILE_VERSION = 2;                // Newest data file format version
+const uint32_t ENDIAN_MARKER = 0x01020304;      // Reads back unchanged only on a machine with the writer's byte order
+const uint64_t PAYLOAD_ALIGNMENT = 4096;        // Version 2 payloads start on a page boundary, as direct I/O requires
+const char FOOTER_MAGIC[4] = { 'B', 'D', 'S', 'F' }; // First bytes of the trailer closing a statistics footer
+const uint32_t FOOTER_BLOCK_VALUES = 1 << 16;   // Values summarized by each footer block
+const int FOOTER_HISTOGRAM_BUCKETS = 16;        // Equal-width buckets over the file's value range in each footer block
+const char INDEX_MAGIC[4] = { 'B', 'D', 'I', 'X' };  // First bytes of a sidecar search index
+const uint32_t INDEX_VERSION = 1;               // Newest sidecar index format version
+const uint32_t INDEX_BLOCK_VALUES = 128;        // Distinct values delta-coded together behind one fence
+const uint64_t SEARCH_STREAM = 0;       // Random stream drawing the values searched for
+const uint64_t GENERATE_STREAM = 1;     // First random stream drawing the values of a generated file, one more per thread
+const uint64_t SKETCH_STREAM = 4096;    // Random stream choosing what a quantile sketch keeps, one more per partition, past
+                                        // the generator threads and still few jumps from the seed
+const size_t GENERATE_CHUNK_VALUES = 1 << 20;   // Values each generator thread buffers between writes
+const int FEW_DISTINCT_VALUES = 16;     // Distinct values in a few-distinct dataset
+const double DEFAULT_ZIPF_EXPONENT = 1.0;   // Skew of a Zipf dataset, larger puts more weight on the smallest values
+const uint64_t BENCHMARK_DEFAULT_MAX_SIZE = 10000000;   // Largest dataset the benchmark suite runs unless asked for more
+const double BENCHMARK_MIN_SECONDS = 0.05;  // Fast kernels repeat until they have run at least this long
+const int BENCHMARK_SEARCH_PROBES = 1 << 16;    // Keys looked up per search benchmark
+const int RANDOM_FILL_LANES = 4;        // Independent generators interleaved by a bulk fill so that it vectorizes
+const double DEFAULT_QUANTILE_ERROR = 0.01;     // Default rank error of sketched quantiles, as a fraction of the values
+const size_t SKETCH_MIN_LEVEL_CAPACITY = 8;     // Fewest values a level of a quantile sketch holds before it is compacted
+const double SKETCHED_QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };  // Fractions of the values a quantile sketch reports
+const int DEFAULT_DISTINCT_PRECISION = 12;      // Default log2 of the registers of a distinct-count sketch, 4 KiB for 1.6% error
+const int MIN_DISTINCT_PRECISION = 4;           // Fewest register bits a distinct-count sketch accepts
+const int MAX_DISTINCT_PRECISION = 18;          // Most register bits a distinct-count sketch accepts, 256 KiB of registers
+const uint64_t DISTINCT_CHECK_VALUES = 1 << 25;  // Distinct values --check-distinct spreads over the trials of each cardinality
+const int DISTINCT_CHECK_MIN_TRIALS = 64;       // Fewest sketches per precision and cardinality whose error --check-distinct averages
+const int DISTINCT_CHECK_MAX_TRIALS = 512;      // Most sketches per precision and cardinality whose error --check-distinct averages
+const double DISTINCT_CHECK_TOLERANCE = 1.5;    // Largest ratio --check-distinct accepts of measured to documented error
+const int PROFILE_COUNTERS = 4;         // Hardware events counted per profiled stage: cycles, instructions, cache and branch misses
+
+// Shapes a generated dataset can take
+enum class Distribution {
+    Uniform,        // Every value of the domain equally likely
+    Normal,         // Bell curve centered on the domain, clamped to it
+    Zipf,           // Value low + k - 1 drawn with probability proportional to 1 / k^s
+    Sorted,         // Ascending run covering the domain
+    ReverseSorted,  // Descending run covering the domain
+    FewDistinct     // A handful of values spread over the domain
+};
+
+// Formats results can be written in
+enum class ResultFormat {
+    Text,       // English sentences, one measure per line
+    Json,       // One JSON object per data file, on one line
+    Binary      // Compact tagged records in host byte order
+};
+
+// Options selected on the command line
+struct Options {
+    bool mapped;    // Memory-map the input file instead of reading it into memory
+    bool streamed;  // Read the input file one block at a time
+    int blockMiB;   // Block size in MiB when streaming
+    bool benchmarkSort; // Time the sort algorithms instead of analyzing a file
+    bool benchmark;     // Run the benchmark suite instead of analyzing a file
+    bool checkDistinct; // Check the error of the distinct-count sketch instead of analyzing a file
+    uint64_t benchmarkMaxSize;  // Largest dataset the benchmark suite runs
+    bool fused;     // Derive every analyzer's result from one shared pass over the data
+    size_t histogramBuckets;    // Largest value range a histogram counts in a flat array
+    long long domainLow;    // Smallest value expected in the data
+    long long domainHigh;   // Largest value expected in the data
+    int probes;     // Number of random values searched for
+    int threads;    // Number of worker threads running analyzers
+    bool legacyFormat;  // Write the generated file in the version 1 format
+    bool writeFooter;   // Append a block statistics footer to the generated file
+    bool summaryOnly;   // Report statistics from the footer alone instead of analyzing the values
+    bool countRange;    // Count the values in [rangeLow, rangeHigh], skipping blocks the footer rules out
+    int rangeLow;       // Smallest value counted
+    int rangeHigh;      // Largest value counted
+    bool useIndex;      // Search through a sidecar index file, building it when missing or stale
+    bool searchOnly;    // Run the search alone, without reading the values when it goes through the sidecar index
+    uint64_t seed;      // Seed of every random stream, so a run can be repeated
+    uint64_t generateCount; // Number of values to generate instead of analyzing a file, or 0
+    Distribution distribution;  // Shape of the generated values
+    double zipfExponent;    // Skew of a Zipf dataset
+    std::string output;     // Name of the generated file
+    ResultFormat format;    // Format the results are written in
+    std::vector<std::string> batchFiles;    // Files to analyze in batch mode instead of generating one, empty otherwise
+    std::string input;      // Existing file to analyze instead of generating binary.dat, empty otherwise
+    bool profile;       // Print the time and hardware events spent in each stage of the run
+    std::string traceFile;  // Trace-event JSON file the stages of the run are written to, empty for none
+    double quantileError;   // Rank error of the quantiles estimated by a sketch, or 0 to take the exact median from sorted values
+    bool selectQuantiles;   // Select the exact median and percentiles from an unsorted copy instead of sorting the values
+    std::vector<double> quantileFractions;  // Fractions of the values, ascending, whose quantiles are reported besides the median
+    int distinctPrecision;  // Register bits of a HyperLogLog sketch estimating distinct values, or 0 to count duplicates exactly
+};
+
+// Header of a data file as stored by version 2, or as recovered from the bare length prefix of version 1
+struct FileHeader {
+    char magic[4];          // FILE_MAGIC
+    uint32_t version;       // Format version, 1 for legacy files
+    uint64_t count;         // Number of values in the payload
+    uint32_t elementWidth;  // Bytes per value
+    uint32_t endianMarker;  // ENDIAN_MARKER as written
+    uint64_t payloadOffset; // Byte offset of the first value
+
+    // Constructor describes an empty version 2 file
+    FileHeader() : version(FILE_VERSION), count(0), elementWidth(sizeof(int)), endianMarker(ENDIAN_MARKER), payloadOffset(PAYLOAD_ALIGNMENT) {
+        std::memcpy(magic, FILE_MAGIC, sizeof(magic));
+    }
+
+    // Decode the header from the first available bytes of a file of fileLength bytes, checking it fits the file
+    void parse(const char* bytes, size_t available, unsigned long long fileLength, const std::string& name) {
+        if (available >= sizeof(FileHeader) && std::memcmp(bytes, FILE_MAGIC, sizeof(magic)) == 0) {
+            std::memcpy(this, bytes, sizeof(FileHeader));
+            if (endianMarker != ENDIAN_MARKER) {
+                throw std::runtime_error(name + " was written with a different byte order");
+            }
+            if (version != FILE_VERSION) {
+                throw std::runtime_error(name + " has unsupported format version " + std::to_string(version));
+            }
+            if (elementWidth != sizeof(int)) {
+                throw std::runtime_error(name + " holds " + std::to_string(elementWidth) + "-byte values, expected " + std::to_string(sizeof(int)));
+            }
+            if (payloadOffset < sizeof(FileHeader)) {
+                throw std::runtime_error(name + " has its payload inside its header");
+            }
+        }
+        else {
+            // Version 1 files start with a native int length and the values right after it
+            int32_t length;
+            if (available < sizeof(length)) {
+                throw std::runtime_error(name + " is too short to hold a header");
+            }
+            std::memcpy(&length, bytes, sizeof(length));
+            if (length < 0) {
+                throw std::runtime_error(name + " has a negative length");
+            }
+            *this = FileHeader();
+            version = 1;
+            count = static_cast<uint64_t>(length);
+            payloadOffset = sizeof(length);
+        }
+        if (fileLength < payloadOffset || (fileLength - payloadOffset) / elementWidth < count) {
+            throw std::runtime_error(name + " is too short for its header");
+        }
+    }
+
+    // Read and decode the header of an open file, leaving the stream at the first value
+    void read(std::istream& in, const std::string& name) {
+        in.seekg(0, std::ios::end);
+        unsigned long long fileLength = static_cast<unsigned long long>(in.tellg());
+        in.seekg(0, std::ios::beg);
+        char bytes[sizeof(FileHeader)];
+        in.read(bytes, sizeof(bytes));
+        size_t available = static_cast<size_t>(in.gcount());
+        in.clear();
+        parse(bytes, available, fileLength, name);
+        in.seekg(static_cast<std::streamoff>(payloadOffset), std::ios::beg);
+    }
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader must match its on-disk layout");
 
 // Function declarations
-void createBinaryFile(const std::string& name, int length);
-void writeBinary(int* values, int length, const std::string& name);
+void createBinaryFile(const std::string& name, int length, uint64_t seed, bool legacy = false, bool footer = false);
+void writeBinary(int* values, int length, const std::string& name, bool legacy = false, bool footer = false);
+void sum_min_max(const int* values, int size, long long& sum, int& min, int& max);
+void file_stamp(const std::string& name, unsigned long long& length, long long& modified);
+void generateDataset(const std::string& name, uint64_t count, Distribution distribution, long long low, long long high,
+                     double zipfExponent, uint64_t seed, int threads, bool legacy = false, bool footer = false);
 void selection_sort(int* values, int size);
-bool binary_search_recursive(int* values, int key, int start, int end);
-bool binary_search(int* values, int size, int key);
+void insertion_sort(int* values, int size);
+void counting_sort(int* values, int size, int min, int max);
+void radix_sort(int* values, int size);
+void sort_values(int* values, int size);
+void introselect(int* values, int size, int rank);
+std::vector<int> select_ranks(int* values, int size, const std::vector<int>& ranks);
+void benchmarkSorts();
+void benchmarkSuite(const Options& options);
+bool checkDistinctSketch(uint64_t seed);
+const char* distribution_name(Distribution distribution);
+unsigned long long allocation_count();
+bool binary_search_recursive(const int* values, int key, int start, int end);
+bool binary_search(const int* values, int size, int key);
+std::vector<std::string> list_batch_files(const std::string& path);
+std::vector<std::string> read_manifest(const std::string& name);
+bool wildcard_match(const char* pattern, const char* name);
+void analyzeBatch(const std::vector<std::string>& named, const Options& options, std::ostream& out, std::ostream& report);
+Options parseOptions(int argc, char* argv[]);
 
-// Base class for data analysis
-class Analyzer {
-protected:
-    int* values;    // Pointer to array of values
-    int size;       // Size of the array
+// Class generating random numbers with xoshiro256**, where each stream of a seed starts 2^128 draws
+// apart from the previous one, so that streams can be handed to threads without overlapping
+class RandomGenerator {
+    uint64_t state[4];  // Generator state, never all zero
+
+    // Helper function to rotate a word left
+    static uint64_t rotl(uint64_t word, int bits) {
+        return (word << bits) | (word >> (64 - bits));
+    }
+
+    // Helper function to draw the next splitmix64 output, used to expand a seed into a full state
+    static uint64_t splitmix64(uint64_t& seed) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
 
-    // Helper function to copy values into internal array
-    void cloneValues(int* values, int size) {
-        this->size = size;
-        this->values = new int[size];
-        std::copy(values, values + size, this->values);
+    // Helper function to advance the state by 2^128 draws
+    void jump() {
+        static const uint64_t polynomial[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+        uint64_t jumped[4] = { 0, 0, 0, 0 };
+        for (uint64_t word : polynomial) {
+            for (int bit = 0; bit < 64; ++bit) {
+                if (word & (1ULL << bit)) {
+                    for (int i = 0; i < 4; ++i) {
+                        jumped[i] ^= state[i];
+                    }
+                }
+                next();
+            }
+        }
+        std::copy(jumped, jumped + 4, state);
     }
 
 public:
-    // Constructor initializes values from input array
-    Analyzer(int* values, int size) : values(nullptr), size(0) {
-        cloneValues(values, size);
+    // Constructor starts the given stream of a seed
+    explicit RandomGenerator(uint64_t seed = 0, uint64_t stream = 0) {
+        for (uint64_t& word : state) {
+            word = splitmix64(seed);
+        }
+        for (uint64_t i = 0; i < stream; ++i) {
+            jump();
+        }
     }
 
-    // Virtual destructor to ensure proper cleanup
-    virtual ~Analyzer() {
-        delete[] values;
+    // Draw the next 64 random bits
+    uint64_t next() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t shifted = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotl(state[3], 45);
+        return result;
     }
 
-    // Virtual function to be overridden by derived classes
-    virtual std::string analyze() = 0;
-};
+    typedef uint64_t result_type;   // Lets standard distributions draw from the generator
 
-// Derived class for statistical analysis
-class StatisticsAnalyzer : public Analyzer {
-public:
-    // Constructor sorts values and initializes base class
-    StatisticsAnalyzer(int* values, int size) : Analyzer(values, size) {
-        selection_sort(this->values, this->size);
+    // Smallest value next() can return
+    static constexpr uint64_t min() {
+        return 0;
     }
 
-    // Analyze method computes statistical measures
-    std::string analyze() override {
-        if (size == 0) return "No data to analyze.";  // Handle empty array case
+    // Largest value next() can return
+    static constexpr uint64_t max() {
+        return ~0ULL;
+    }
 
-        int min = values[0];    // Initialize min value
-        int max = values[size - 1]; // Initialize max value
-        double sum = 0; // Initialize sum for mean calculation
+    // Draw the next 64 random bits, for standard distributions
+    uint64_t operator()() {
+        return next();
+    }
 
-        // Map to store frequency of each value
-        std::unordered_map<int, int> frequencyMap;
-        for (int i = 0; i < size; ++i) {
-            sum += values[i];
-            frequencyMap[values[i]]++;
+    // Draw a double in [0, 1) from the high 53 bits
+    double uniform() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Draw a value in [0, bound) by scaling the high 32 bits, without a division
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>(((next() >> 32) * bound) >> 32);
+    }
+
+    // Fill values with draws in [0, bound), running RANDOM_FILL_LANES generators side by side
+    // in structure-of-arrays form so that the compiler can keep them in vector registers
+    void fill(int* values, size_t count, uint32_t bound) {
+        uint64_t lanes[4][RANDOM_FILL_LANES];
+        for (int lane = 0; lane < RANDOM_FILL_LANES; ++lane) {
+            uint64_t seed = next();
+            for (int i = 0; i < 4; ++i) {
+                lanes[i][lane] = splitmix64(seed);
+            }
         }
 
-        double mean = sum / size;   // Calculate mean
+        size_t i = 0;
+        for (; i + RANDOM_FILL_LANES <= count; i += RANDOM_FILL_LANES) {
+            for (int lane = 0; lane < RANDOM_FILL_LANES; ++lane) {
+                uint64_t result = rotl(lanes[1][lane] * 5, 7) * 9;
+                uint64_t shifted = lanes[1][lane] << 17;
+                lanes[2][lane] ^= lanes[0][lane];
+                lanes[3][lane] ^= lanes[1][lane];
+                lanes[1][lane] ^= lanes[2][lane];
+                lanes[0][lane] ^= lanes[3][lane];
+                lanes[2][lane] ^= shifted;
+                lanes[3][lane] = rotl(lanes[3][lane], 45);
+                values[i + lane] = static_cast<int>(((result >> 32) * bound) >> 32);
+            }
+        }
+        for (; i < count; ++i) {
+            values[i] = static_cast<int>(below(bound));
+        }
+    }
+};
 
-        // Calculate median
-        double median = (size % 2 == 0) ? (values[size / 2 - 1] + values[size / 2]) / 2.0 : values[size / 2];
+// Class drawing the values of a generated dataset of a given shape over the domain [low, high]
+class ValueDistribution {
+    Distribution kind;  // Shape of the values
+    long long low;      // Smallest value of the domain
+    long long high;     // Largest value of the domain
+    uint64_t total;     // Number of values in the whole dataset, which the sorted shapes are spread over
+    double exponent;    // Zipf exponent s
+    double hIntegralX1; // Zipf sampler constant H(1.5) - 1
+    double hIntegralN;  // Zipf sampler constant H(n + 0.5)
+    double squeeze;     // Zipf sampler constant accepting most draws without evaluating h
 
-        // Calculate mode
-        int mode = values[0];
-        int maxFrequency = 1;
-        for (const auto& pair : frequencyMap) {
-            if (pair.second > maxFrequency) {
-                maxFrequency = pair.second;
-                mode = pair.first;
+    // Helper function for log(1 + x) / x, accurate near zero
+    static double helper1(double x) {
+        return std::fabs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+    }
+
+    // Helper function for (exp(x) - 1) / x, accurate near zero
+    static double helper2(double x) {
+        return std::fabs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x));
+    }
+
+    // Helper function for the Zipf weight h(x) = x^-s
+    double h(double x) const {
+        return std::exp(-exponent * std::log(x));
+    }
+
+    // Helper function for H(x), an integral of h
+    double hIntegral(double x) const {
+        double logX = std::log(x);
+        return helper2((1 - exponent) * logX) * logX;
+    }
+
+    // Helper function for the inverse of H
+    double hIntegralInverse(double x) const {
+        double t = std::max(x * (1 - exponent), -1.0);
+        return std::exp(helper1(t) * x);
+    }
+
+    // Helper function to draw a Zipf rank in [1, n] by rejection-inversion (Hormann and Derflinger),
+    // which needs no table, so the domain can span the whole int range
+    long long zipfRank(RandomGenerator& random) const {
+        long long n = high - low + 1;
+        for (;;) {
+            double u = hIntegralN + random.uniform() * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            long long k = std::min(std::max(static_cast<long long>(x + 0.5), 1LL), n);
+            if (k - x <= squeeze || u >= hIntegral(k + 0.5) - h(static_cast<double>(k))) {
+                return k;
             }
         }
+    }
 
-        // Prepare result string
-        std::ostringstream result;
-        result << "The minimum value is " << min << "\n";
-        result << "The maximum value is " << max << "\n";
-        result << "The mean value is " << mean << "\n";
-        result << "The median value is " << median << "\n";
-        result << "The mode value is " << mode << " which occurred " << maxFrequency << " times";
+public:
+    // Constructor prepares to draw total values over [low, high]
+    ValueDistribution(Distribution kind, long long low, long long high, uint64_t total, double exponent = DEFAULT_ZIPF_EXPONENT)
+        : kind(kind), low(low), high(high), total(total), exponent(exponent), hIntegralX1(0), hIntegralN(0), squeeze(0) {
+        if (kind == Distribution::Zipf) {
+            hIntegralX1 = hIntegral(1.5) - 1;
+            hIntegralN = hIntegral(static_cast<double>(high - low + 1) + 0.5);
+            squeeze = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+        }
+    }
 
-        return result.str();    // Return result as string
+    // Fill values with the count values of the dataset starting at index first
+    void fill(int* values, size_t count, uint64_t first, RandomGenerator& random) const {
+        unsigned long long span = static_cast<unsigned long long>(high - low) + 1;
+        switch (kind) {
+        case Distribution::Uniform:
+            if (span <= 0xFFFFFFFFULL) {
+                random.fill(values, count, static_cast<uint32_t>(span));
+                for (size_t i = 0; i < count; ++i) {
+                    values[i] = static_cast<int>(low + values[i]);
+                }
+            }
+            else {
+                for (size_t i = 0; i < count; ++i) {
+                    values[i] = static_cast<int>(static_cast<uint32_t>(random.next() >> 32));   // The domain is every int
+                }
+            }
+            break;
+        case Distribution::Normal: {
+            // Box-Muller on the generator's own output rather than std::normal_distribution, whose algorithm differs
+            // between standard libraries, so a seed repeats a file wherever it is built
+            double mean = (static_cast<double>(low) + high) / 2;
+            double deviation = static_cast<double>(span) / 8;
+            const double twoPi = 6.283185307179586;
+            for (size_t i = 0; i < count; i += 2) {
+                double radius = std::sqrt(-2 * std::log(1 - random.uniform()));   // 1 - uniform() lies in (0, 1]
+                double angle = twoPi * random.uniform();
+                double pair[2] = { radius * std::cos(angle), radius * std::sin(angle) };
+                for (size_t j = 0; j < 2 && i + j < count; ++j) {
+                    double value = std::round(mean + deviation * pair[j]);
+                    values[i + j] = static_cast<int>(std::min(std::max(value, static_cast<double>(low)), static_cast<double>(high)));
+                }
+            }
+            break;
+        }
+        case Distribution::Zipf:
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = static_cast<int>(low + zipfRank(random) - 1);
+            }
+            break;
+        case Distribution::Sorted:
+        case Distribution::ReverseSorted:
+            // Index i maps to the fraction i / total of the domain, which never decreases as i grows
+            for (size_t i = 0; i < count; ++i) {
+                long long offset = static_cast<long long>(static_cast<double>(first + i) / total * static_cast<double>(span));
+                offset = std::min(offset, static_cast<long long>(span - 1));
+                values[i] = static_cast<int>(kind == Distribution::Sorted ? low + offset : high - offset);
+            }
+            break;
+        case Distribution::FewDistinct: {
+            // A domain narrower than FEW_DISTINCT_VALUES holds each of its values once, one apart
+            uint32_t distinct = static_cast<uint32_t>(std::min<unsigned long long>(FEW_DISTINCT_VALUES, span));
+            unsigned long long step = std::max<unsigned long long>(1, span / distinct);
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = static_cast<int>(low + static_cast<long long>(random.below(distinct) * step));
+            }
+            break;
+        }
+        }
     }
 };
 
-// Derived class for detecting duplicated values
-class DuplicateAnalyzer : public Analyzer {
+// Class counting hardware events on the calling thread through Linux perf_event, where the kernel allows it
+class HardwareCounters {
+    int descriptors[PROFILE_COUNTERS]; // Descriptor of each event, the first leading the group, or -1 when not open
+    bool available;                     // Whether every event could be opened
+
 public:
-    // Constructor initializes base class
-    DuplicateAnalyzer(int* values, int size) : Analyzer(values, size) {}
+    // Constructor opens the events as one group, so that they are counted over the same stretch of execution
+    HardwareCounters() : available(false) {
+        std::fill(descriptors, descriptors + PROFILE_COUNTERS, -1);
+#ifdef __linux__
+        const uint64_t events[PROFILE_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        available = true;
+        for (int i = 0; i < PROFILE_COUNTERS && available; ++i) {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = events[i];
+            attributes.read_format = PERF_FORMAT_GROUP;
+            attributes.exclude_kernel = 1;  // Count user code only, which unprivileged processes are usually allowed to
+            attributes.exclude_hv = 1;
+            descriptors[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, i == 0 ? -1 : descriptors[0], 0));
+            available = descriptors[i] >= 0;
+        }
+#endif
+    }
 
-    // Analyze method counts duplicated values
-    std::string analyze() override {
-        std::unordered_map<int, int> countMap;
-        for (int i = 0; i < size; ++i) {
-            countMap[values[i]]++;
+    // Destructor closes the events
+    ~HardwareCounters() {
+#ifdef __linux__
+        for (int descriptor : descriptors) {
+            if (descriptor >= 0) {
+                close(descriptor);
+            }
         }
+#endif
+    }
 
-        int duplicateCount = 0;
-        for (const auto& pair : countMap) {
-            if (pair.second > 1) {
-                duplicateCount += pair.second - 1;
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    // Read the running count of every event, returning false when the events are not available
+    bool sample(uint64_t counts[PROFILE_COUNTERS]) const {
+#ifdef __linux__
+        if (available) {
+            uint64_t group[1 + PROFILE_COUNTERS];   // Number of events, then the count of each
+            if (read(descriptors[0], group, sizeof(group)) == static_cast<ssize_t>(sizeof(group))) {
+                std::copy(group + 1, group + 1 + PROFILE_COUNTERS, counts);
+                return true;
             }
         }
+#endif
+        (void)counts;
+        return false;
+    }
 
-        std::ostringstream result;
-        result << "There were " << duplicateCount << " duplicated values";
-        return result.str();
+    // Getter for the events of the calling thread, opened on its first request
+    static const HardwareCounters& forThread() {
+        static thread_local HardwareCounters counters;
+        return counters;
     }
 };
 
-// Derived class for detecting missing values
-class MissingAnalyzer : public Analyzer {
+// Class adding up the time and hardware events spent in each named stage of a run
+class Profiler {
+    // Totals for one stage
+    struct Stage {
+        std::string name;           // Name shown in the table
+        unsigned long long calls;   // Number of times the stage ran
+        double seconds;             // Time spent in the stage over all calls
+        uint64_t counts[PROFILE_COUNTERS];  // Hardware events counted in the stage over all calls
+        bool counted;               // Whether the events of every call were counted
+    };
+
+    std::vector<Stage> stages;  // Stages in the order they first finished
+    mutable std::mutex mutex;   // Guards stages
+    std::atomic<bool> enabled;  // Whether scoped timers record anything
+
 public:
-    // Constructor initializes base class
-    MissingAnalyzer(int* values, int size) : Analyzer(values, size) {}
+    // Constructor starts disabled, so that scoped timers cost one check
+    Profiler() : enabled(false) {}
 
-    // Analyze method counts missing values
-    std::string analyze() override {
-        std::unordered_map<int, bool> valueMap;
-        for (int i = 0; i < size; ++i) {
-            valueMap[values[i]] = true;
+    // Start recording stages
+    void enable() {
+        enabled = true;
+    }
+
+    // Check whether stages are recorded
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Add one call of a stage, with the hardware events it took or nullptr when they were not counted
+    void record(const char* name, double seconds, const uint64_t* counts) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto stage = std::find_if(stages.begin(), stages.end(), [name](const Stage& s) { return s.name == name; });
+        if (stage == stages.end()) {
+            Stage added;
+            added.name = name;
+            added.calls = 0;
+            added.seconds = 0;
+            std::fill(added.counts, added.counts + PROFILE_COUNTERS, 0);
+            added.counted = true;
+            stage = stages.insert(stages.end(), added);
         }
+        stage->calls++;
+        stage->seconds += seconds;
+        if (counts != nullptr) {
+            for (int i = 0; i < PROFILE_COUNTERS; ++i) {
+                stage->counts[i] += counts[i];
+            }
+        }
+        else {
+            stage->counted = false;
+        }
+    }
 
-        int missingCount = 0;
-        for (int i = 0; i < 1000; ++i) {
-            if (valueMap.find(i) == valueMap.end()) {
-                missingCount++;
+    // Write a table of the stages, with '-' where hardware events were not counted.
+    // Stages nest, so a stage's time includes that of the stages it ran, such as a sort inside a constructor
+    void print(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        out << "\nProfile by stage, '-' where hardware counters are unavailable\n";
+        out << std::left << std::setw(34) << "Stage" << std::right << std::setw(8) << "Calls" << std::setw(12) << "ms"
+            << std::setw(16) << "Cycles" << std::setw(16) << "Instructions" << std::setw(7) << "IPC"
+            << std::setw(14) << "Cache misses" << std::setw(14) << "Branch misses" << "\n";
+        for (const Stage& stage : stages) {
+            out << std::left << std::setw(34) << stage.name << std::right << std::setw(8) << stage.calls
+                << std::fixed << std::setprecision(3) << std::setw(12) << stage.seconds * 1000;
+            if (stage.counted) {
+                double ipc = stage.counts[0] > 0 ? static_cast<double>(stage.counts[1]) / stage.counts[0] : 0;
+                out << std::setw(16) << stage.counts[0] << std::setw(16) << stage.counts[1]
+                    << std::setprecision(2) << std::setw(7) << ipc << std::setw(14) << stage.counts[2] << std::setw(14) << stage.counts[3];
             }
+            else {
+                out << std::setw(16) << "-" << std::setw(16) << "-" << std::setw(7) << "-" << std::setw(14) << "-" << std::setw(14) << "-";
+            }
+            out << "\n";
         }
+        out.unsetf(std::ios::fixed);
+    }
+};
+
+// Class collecting every stage as a span on the thread that ran it, written out in the Chrome trace-event format
+// that chrome://tracing and Perfetto open
+class TraceRecorder {
+    // One finished span
+    struct Span {
+        const char* name;   // Stage name, a string literal
+        int thread;         // Number of the thread that ran the stage
+        double start;       // Microseconds from the start of the recording to the start of the span
+        double duration;    // Microseconds the span lasted
+    };
+
+    std::vector<Span> spans;    // Spans in the order they finished
+    std::mutex mutex;           // Guards spans
+    std::atomic<bool> enabled;  // Whether scoped timers record spans
+    std::atomic<int> threadCount;   // Number of threads numbered so far
+    std::chrono::steady_clock::time_point origin;   // Time the recording started
+
+public:
+    // Constructor starts disabled
+    TraceRecorder() : enabled(false), threadCount(0) {}
+
+    // Start recording spans, timed from now
+    void enable() {
+        origin = std::chrono::steady_clock::now();
+        enabled = true;
+    }
+
+    // Check whether spans are recorded
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Getter for the number of the calling thread, numbered in the order threads first record a span
+    int threadNumber() {
+        static thread_local int number = threadCount++;
+        return number;
+    }
+
+    // Add a span of the calling thread
+    void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+        Span span;
+        span.name = name;
+        span.thread = threadNumber();
+        span.start = std::chrono::duration<double, std::micro>(start - origin).count();
+        span.duration = std::chrono::duration<double, std::micro>(end - start).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        spans.push_back(span);
+    }
 
-        std::ostringstream result;
-        result << "There were " << missingCount << " missing values";
-        return result.str();
+    // Write the spans as complete events to a trace-event JSON file, naming thread 0 main and the rest workers
+    void write(const std::string& name) {
+        std::ofstream outFile(name);
+        if (!outFile) {
+            throw std::runtime_error("Cannot create " + name);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        outFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (int thread = 0; thread < threadCount; ++thread) {
+            outFile << (thread == 0 ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+                    << ",\"args\":{\"name\":\"" << (thread == 0 ? "main" : "worker " + std::to_string(thread)) << "\"}}";
+        }
+        outFile << std::fixed << std::setprecision(3);
+        for (const Span& span : spans) {
+            outFile << ",\n{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+                    << ",\"ts\":" << span.start << ",\"dur\":" << span.duration << "}";
+        }
+        outFile << "\n]}\n";
+        if (!outFile) {
+            throw std::runtime_error("Cannot write " + name);
+        }
     }
 };
 
-// Derived class for searching random values
-class SearchAnalyzer : public Analyzer {
+Profiler profiler;  // Profiler every scoped timer records into, enabled by --profile
+TraceRecorder tracer;   // Trace every scoped timer records a span into, enabled by --trace
+
+// Class timing the scope it lives in as one call of a named stage, doing nothing while profiling and tracing are off
+class ScopedTimer {
+    const char* name;   // Stage the time is recorded under, or nullptr when profiling and tracing are off
+    std::chrono::steady_clock::time_point start;    // Time the scope was entered
+    uint64_t startCounts[PROFILE_COUNTERS];         // Hardware event counts when the scope was entered
+    bool counted;       // Whether startCounts was read
+
 public:
-    // Constructor sorts values and initializes base class
-    SearchAnalyzer(int* values, int size) : Analyzer(values, size) {
-        selection_sort(this->values, this->size);
+    // Constructor notes the time, and the hardware event counts when profiling, on entry
+    explicit ScopedTimer(const char* name) : name(profiler.isEnabled() || tracer.isEnabled() ? name : nullptr), counted(false) {
+        if (this->name != nullptr) {
+            counted = profiler.isEnabled() && HardwareCounters::forThread().sample(startCounts);
+            start = std::chrono::steady_clock::now();
+        }
     }
 
-    // Analyze method searches for random values
-    std::string analyze() override {
-        int foundCount = 0;
-        for (int i = 0; i < 100; ++i) {
-            int searchValue = rand() % 1000;
-            if (binary_search(values, size, searchValue)) {
-                foundCount++;
+    // Destructor records the time and hardware events spent since entry as a stage of the profile and a span of the trace
+    ~ScopedTimer() {
+        if (name != nullptr) {
+            auto end = std::chrono::steady_clock::now();
+            if (profiler.isEnabled()) {
+                double seconds = std::chrono::duration<double>(end - start).count();
+                uint64_t counts[PROFILE_COUNTERS];
+                bool complete = counted && HardwareCounters::forThread().sample(counts);
+                for (int i = 0; complete && i < PROFILE_COUNTERS; ++i) {
+                    counts[i] -= startCounts[i];
+                }
+                profiler.record(name, seconds, complete ? counts : nullptr);
+            }
+            if (tracer.isEnabled()) {
+                tracer.record(name, start, end);
+            }
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+// Class running tasks on a fixed number of worker threads
+class ThreadPool {
+    std::vector<std::thread> workers;       // Threads taking tasks from the queue
+    std::queue<std::function<void()>> tasks;    // Tasks not yet started
+    std::mutex mutex;                       // Guards tasks, active and stopping
+    std::condition_variable available;      // Signalled when a task is queued or the pool stops
+    std::condition_variable idle;           // Signalled when the last running task finishes
+    size_t active;                          // Number of tasks queued or running
+    bool stopping;                          // Whether workers should exit once the queue is empty
+
+    // Helper function holding the pool the calling thread works for, or nullptr
+    static ThreadPool*& running() {
+        thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    // Helper function run by each worker thread
+    void work() {
+        running() = this;
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            {
+                ScopedTimer timer("ThreadPool task");
+                task();
             }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+
+public:
+    // Constructor starts the worker threads
+    explicit ThreadPool(size_t threads) : active(0), stopping(false) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+            workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    // Destructor finishes queued tasks and joins the worker threads
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task to run on the next free worker, the task must not throw
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+            active++;
+        }
+        available.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return active == 0; });
+    }
+
+    // Getter for the pool whose worker is the calling thread, or nullptr outside any pool
+    static ThreadPool* current() {
+        return running();
+    }
+
+    // Getter for number of worker threads
+    size_t getSize() const {
+        return workers.size();
+    }
+};
+
+// Class for mapping a file read-only into memory
+class MappedFile {
+#ifdef _WIN32
+    HANDLE file;        // Handle of the open file
+    HANDLE mapping;     // Handle of the file mapping object
+#else
+    int fd;             // Descriptor of the open file
+#endif
+    const char* data;   // Start of the mapped bytes
+    size_t length;      // Number of mapped bytes
+
+public:
+    // Constructor creates an empty mapping
+#ifdef _WIN32
+    MappedFile() : file(INVALID_HANDLE_VALUE), mapping(nullptr), data(nullptr), length(0) {}
+#else
+    MappedFile() : fd(-1), data(nullptr), length(0) {}
+#endif
+
+    // Destructor unmaps the file
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map the whole file, pages are faulted in on first access
+    void open(const std::string& name) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Cannot open " + name);
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            close();
+            throw std::runtime_error("Cannot get the size of " + name);
+        }
+        length = static_cast<size_t>(fileSize.QuadPart);
+        if (length == 0) {
+            return;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            close();
+            throw std::runtime_error("Cannot map " + name);
+        }
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr) {
+            close();
+            throw std::runtime_error("Cannot map " + name);
+        }
+#else
+        fd = ::open(name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + name);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close();
+            throw std::runtime_error("Cannot get the size of " + name);
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length == 0) {
+            return;
+        }
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            close();
+            throw std::runtime_error("Cannot map " + name);
+        }
+        data = static_cast<const char*>(address);
+#endif
+    }
+
+    // Unmap the file and release its handles
+    void close() {
+#ifdef _WIN32
+        if (data != nullptr) {
+            UnmapViewOfFile(data);
         }
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), length);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+#endif
+        data = nullptr;
+        length = 0;
+    }
+
+    // Getter for the mapped bytes
+    const char* getData() const {
+        return data;
+    }
 
-        std::ostringstream result;
-        result << "There were " << foundCount << " random values found";
-        return result.str();
+    // Getter for the number of mapped bytes
+    size_t getLength() const {
+        return length;
     }
 };
 
 // Class for reading binary data from file
 class BinaryReader {
-    int* values;    // Pointer to array of values
-    int size;       // Size of the array
+    int* values;        // Pointer to array of values, or nullptr when mapped
+    const int* view;    // Read-only view of the values, in the array or in the mapping
+    int size;           // Size of the array
+    MappedFile mapping; // Mapping of the file when reading without a copy
+    FileHeader header;  // Header of the file
+
+    // Helper function to take the size of array from a header, which must fit in an int to be held at once
+    void setSize(const FileHeader& header, const std::string& name) {
+        if (header.count > static_cast<uint64_t>(INT_MAX)) {
+            throw std::runtime_error(name + " holds " + std::to_string(header.count) + " values, too many to hold at once, use --stream");
+        }
+        size = static_cast<int>(header.count);
+    }
 
     // Helper function to read values from binary file
     void readValues(const std::string& name) {
         std::ifstream inFile(name, std::ios::binary);   // Open file in binary mode
-        inFile.read(reinterpret_cast<char*>(&size), sizeof(size));   // Read size of array
+        if (!inFile) {
+            throw std::runtime_error("Cannot open " + name);
+        }
+        header.read(inFile, name);  // Read header of either format version
+        setSize(header, name);
         values = new int[size]; // Allocate memory for array
-        inFile.read(reinterpret_cast<char*>(values), size * sizeof(int));  // Read array elements
+        inFile.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(size) * sizeof(int));  // Read array elements
         inFile.close(); // Close file stream
+        view = values;
+    }
+
+    // Helper function to view values in place in the mapped binary file
+    void mapValues(const std::string& name) {
+        mapping.open(name);
+        header.parse(mapping.getData(), std::min<size_t>(mapping.getLength(), sizeof(FileHeader)), mapping.getLength(), name);
+        setSize(header, name);
+        view = reinterpret_cast<const int*>(mapping.getData() + header.payloadOffset);   // Array elements start at the payload offset
     }
 
 public:
-    // Constructor reads values from binary file
-    BinaryReader(const std::string& name) : values(nullptr), size(0) {
-        readValues(name);
+    // Constructor reads values from binary file, or maps it when mapped is set
+    BinaryReader(const std::string& name, bool mapped = false) : values(nullptr), view(nullptr), size(0) {
+        ScopedTimer timer(mapped ? "BinaryReader map" : "BinaryReader read");
+        if (mapped) {
+            mapValues(name);
+        }
+        else {
+            readValues(name);
+        }
     }
 
     // Destructor frees allocated memory
@@ -196,96 +1026,3848 @@ public:
         delete[] values;
     }
 
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
     // Getter for values pointer
-    int* getValues() const {
-        return values;
+    const int* getValues() const {
+        return view;
     }
 
     // Getter for size of array
     int getSize() const {
         return size;
     }
+
+    // Getter for the header of the file
+    const FileHeader& getHeader() const {
+        return header;
+    }
 };
 
-// Function to create a binary file with random data
-void createBinaryFile(const std::string& name, int length) {
-    std::vector<int> array(length); // Create vector to hold random values
-    for (int& num : array) {
-        num = rand() % 1000;    // Generate random number between 0 and 999
+// Summary of one block of values as stored in a statistics footer
+struct BlockSummary {
+    int32_t min;        // Smallest value of the block
+    int32_t max;        // Largest value of the block
+    int64_t sum;        // Exact sum of the block
+    uint32_t count;     // Number of values in the block
+    uint32_t reserved;  // Zero, keeps the histogram aligned
+    uint32_t histogram[FOOTER_HISTOGRAM_BUCKETS];   // Values of the block in each bucket of the file's value range
+};
+
+// Trailer closing a statistics footer, the last bytes of the file
+struct FooterTrailer {
+    char magic[4];          // FOOTER_MAGIC
+    uint32_t blockValues;   // Values summarized by each block but the last
+    uint64_t blockCount;    // Number of block summaries before the trailer
+    int32_t min;            // Smallest value of the file, the low end of the histogram buckets
+    int32_t max;            // Largest value of the file, the high end of the histogram buckets
+};
+
+static_assert(sizeof(BlockSummary) == 88, "BlockSummary must match its on-disk layout");
+static_assert(sizeof(FooterTrailer) == 24, "FooterTrailer must match its on-disk layout");
+
+struct FooterSummaryResult;
+
+// Class for per-block statistics stored after the payload of a version 2 file, so that summary
+// queries need not read the values and range scans can skip blocks that cannot match
+class StatisticsFooter {
+    FooterTrailer trailer;              // Layout and value range of the footer
+    std::vector<BlockSummary> blocks;   // Summary of each block in file order
+
+    // Helper function to pick the histogram bucket of a value within [trailer.min, trailer.max]
+    int bucketOf(int value) const {
+        long long span = static_cast<long long>(trailer.max) - trailer.min + 1;
+        return static_cast<int>((static_cast<long long>(value) - trailer.min) * FOOTER_HISTOGRAM_BUCKETS / span);
     }
-    writeBinary(array.data(), length, name);   // Write vector data to binary file
-}
 
-// Function to write data into a binary file
-void writeBinary(int* values, int length, const std::string& name) {
-    std::ofstream outFile(name, std::ios::binary); // Open file in binary mode
-    outFile.write(reinterpret_cast<const char*>(&length), sizeof(length));   // Write size of array
-    outFile.write(reinterpret_cast<const char*>(values), length * sizeof(int)); // Write array elements
-    outFile.close();    // Close file stream
-}
+public:
+    // Constructor creates a footer with no blocks
+    StatisticsFooter() : trailer() {
+        std::memcpy(trailer.magic, FOOTER_MAGIC, sizeof(trailer.magic));
+        trailer.blockValues = FOOTER_BLOCK_VALUES;
+    }
 
-// Function to perform selection sort on array
-void selection_sort(int* values, int size) {
-    for (int i = 0; i < size - 1; ++i) {
-        int minIndex = i;
-        for (int j = i + 1; j < size; ++j) {
-            if (values[j] < values[minIndex]) {
-                minIndex = j;
+    // Summarize count values in blocks of blockValues
+    void build(const int* values, uint64_t count, uint32_t blockValues = FOOTER_BLOCK_VALUES) {
+        trailer.blockValues = std::max<uint32_t>(blockValues, 1);
+        trailer.blockCount = (count + trailer.blockValues - 1) / trailer.blockValues;
+        blocks.assign(static_cast<size_t>(trailer.blockCount), BlockSummary());
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            BlockSummary& block = blocks[i];
+            const int* first = values + i * trailer.blockValues;
+            block.count = static_cast<uint32_t>(std::min<uint64_t>(trailer.blockValues, count - i * trailer.blockValues));
+            long long sum;
+            sum_min_max(first, static_cast<int>(block.count), sum, block.min, block.max);
+            block.sum = sum;
+            trailer.min = i == 0 ? block.min : std::min(trailer.min, block.min);
+            trailer.max = i == 0 ? block.max : std::max(trailer.max, block.max);
+        }
+
+        // The histogram buckets span the whole file, so they are filled once its range is known
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            const int* first = values + i * trailer.blockValues;
+            for (uint32_t j = 0; j < blocks[i].count; ++j) {
+                blocks[i].histogram[bucketOf(first[j])]++;
             }
         }
-        std::swap(values[i], values[minIndex]);    // Swap elements to sort
     }
-}
 
-// Recursive function for binary search
-bool binary_search_recursive(int* values, int key, int start, int end) {
-    if (start > end) {
-        return false;
+    // Append the block summaries and the trailer to a stream positioned after the payload
+    void write(std::ostream& out) const {
+        out.write(reinterpret_cast<const char*>(blocks.data()), static_cast<std::streamsize>(blocks.size() * sizeof(BlockSummary)));
+        out.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
     }
-    int mid = start + (end - start) / 2;
-    if (values[mid] == key) {
+
+    // Load the footer of a file with the given header, returns false when the file has none
+    bool read(const std::string& name, const FileHeader& header) {
+        std::ifstream inFile(name, std::ios::binary);
+        if (!inFile) {
+            throw std::runtime_error("Cannot open " + name);
+        }
+        inFile.seekg(0, std::ios::end);
+        unsigned long long fileLength = static_cast<unsigned long long>(inFile.tellg());
+        unsigned long long payloadEnd = header.payloadOffset + header.count * header.elementWidth;
+        if (header.version < 2 || fileLength < payloadEnd + sizeof(FooterTrailer)) {
+            return false;
+        }
+        inFile.seekg(static_cast<std::streamoff>(fileLength - sizeof(FooterTrailer)), std::ios::beg);
+        inFile.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+        if (!inFile || std::memcmp(trailer.magic, FOOTER_MAGIC, sizeof(trailer.magic)) != 0) {
+            return false;
+        }
+        if (trailer.blockValues == 0 || trailer.blockCount != (header.count + trailer.blockValues - 1) / trailer.blockValues
+            || fileLength - payloadEnd - sizeof(FooterTrailer) != trailer.blockCount * sizeof(BlockSummary)) {
+            throw std::runtime_error(name + " has a footer that does not match its payload");
+        }
+        blocks.resize(static_cast<size_t>(trailer.blockCount));
+        inFile.seekg(static_cast<std::streamoff>(payloadEnd), std::ios::beg);
+        inFile.read(reinterpret_cast<char*>(blocks.data()), static_cast<std::streamsize>(blocks.size() * sizeof(BlockSummary)));
+        if (!inFile) {
+            throw std::runtime_error("Cannot read the footer of " + name);
+        }
         return true;
     }
-    if (values[mid] > key) {
-        return binary_search_recursive(values, key, start, mid - 1);
-    }
-    return binary_search_recursive(values, key, mid + 1, end);
-}
-
-// Function to perform binary search on array
-bool binary_search(int* values, int size, int key) {
-    return binary_search_recursive(values, key, 0, size - 1);
-}
 
-// Main function
-int main() {
-    // Program introduction
-    std::cout << "Binary Data Analyzer\n" << "\n";
+    // Gather min, max, mean and the value histogram from the block summaries alone
+    void summarize(FooterSummaryResult& result) const;
 
-    // Seed the random number generator
-    srand(static_cast<unsigned int>(time(0)));
+    // Count the payload values in [low, high], scanning only the blocks whose range overlaps it partly
+    unsigned long long countInRange(const int* values, int low, int high, unsigned long long& blocksScanned) const {
+        unsigned long long found = 0;
+        blocksScanned = 0;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            const BlockSummary& block = blocks[i];
+            if (block.max < low || block.min > high) {
+                continue;   // No value of the block can match
+            }
+            if (block.min >= low && block.max <= high) {
+                found += block.count;   // Every value of the block matches
+                continue;
+            }
+            const int* first = values + i * trailer.blockValues;
+            for (uint32_t j = 0; j < block.count; ++j) {
+                found += first[j] >= low && first[j] <= high;
+            }
+            blocksScanned++;
+        }
+        return found;
+    }
+
+    // Getter for number of blocks
+    size_t getBlockCount() const {
+        return blocks.size();
+    }
+};
+
+// Bucket budget shared by the histograms of every count width
+struct HistogramBudget {
+    static size_t defaultMaxBuckets;    // Bucket budget for histograms built without an explicit one
+};
+
+// Class for counting occurrences of each value, in a flat array indexed by value - base while
+// the value range fits the bucket budget, and in an open-addressing hash table beyond it.
+// Either way it holds one count per distinct value, which the budget does not bound
+template <typename Count>
+class BasicHistogram : public HistogramBudget {
+    size_t maxBuckets;              // Largest value range counted in the flat array
+    long long base;                 // Value counted by dense[0]
+    std::vector<Count> dense;       // Count of each value in [base, base + dense.size())
+    bool hashed;                    // Whether counting has moved to the hash table
+    std::vector<int> keys;          // Value of each hash slot
+    std::vector<Count> counts;      // Count of each hash slot, zero for an empty slot
+    size_t used;                    // Number of occupied hash slots
+
+    // Helper function to pick the home slot of a value in the hash table
+    size_t slotOf(int value) const {
+        unsigned long long hash = static_cast<unsigned int>(value) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(hash >> 32) & (keys.size() - 1);
+    }
+
+    // Helper function to add occurrences of a value to the hash table, returns its new count
+    Count addHashed(int value, Count occurrences) {
+        if ((used + 1) * 2 > keys.size()) {
+            rehash(std::max<size_t>(keys.size() * 2, 1024));
+        }
+        size_t slot = slotOf(value);
+        while (counts[slot] != 0 && keys[slot] != value) {
+            slot = (slot + 1) & (keys.size() - 1);  // Linear probing
+        }
+        if (counts[slot] == 0) {
+            keys[slot] = value;
+            used++;
+        }
+        counts[slot] += occurrences;
+        return counts[slot];
+    }
+
+    // Helper function to move every slot into a hash table of the given power-of-two capacity
+    void rehash(size_t capacity) {
+        std::vector<int> oldKeys(capacity);
+        std::vector<Count> oldCounts(capacity, 0);
+        oldKeys.swap(keys);
+        oldCounts.swap(counts);
+        used = 0;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldCounts[i] != 0) {
+                addHashed(oldKeys[i], oldCounts[i]);
+            }
+        }
+    }
+
+    // Helper function to widen the flat array to cover value, or move to the hash table
+    // once the covered range would exceed the bucket budget
+    void grow(int value) {
+        long long low = dense.empty() ? value : std::min<long long>(base, value);
+        long long high = dense.empty() ? value : std::max<long long>(base + static_cast<long long>(dense.size()) - 1, value);
+        if (static_cast<unsigned long long>(high - low + 1) > maxBuckets) {
+            hashed = true;
+            rehash(1024);
+            for (size_t i = 0; i < dense.size(); ++i) {
+                if (dense[i] != 0) {
+                    addHashed(static_cast<int>(base + static_cast<long long>(i)), dense[i]);
+                }
+            }
+            std::vector<Count>().swap(dense);
+            return;
+        }
+
+        // Double the span on each growth so that widening stays amortized O(1) per value
+        long long span = std::max<long long>(high - low + 1, 2 * static_cast<long long>(dense.size()));
+        span = std::min<long long>(span, static_cast<long long>(maxBuckets));
+        if (!dense.empty() && value < base) {
+            low = std::max<long long>(high - span + 1, INT_MIN);
+            high = low + span - 1;
+        }
+        else {
+            high = std::min<long long>(low + span - 1, INT_MAX);
+            low = high - span + 1;
+        }
+
+        std::vector<Count> widened(static_cast<size_t>(high - low + 1), 0);
+        if (!dense.empty()) {
+            std::copy(dense.begin(), dense.end(), widened.begin() + static_cast<size_t>(base - low));
+        }
+        dense.swap(widened);
+        base = low;
+    }
+
+public:
+    // Constructor starts empty, counting in a flat array of at most maxBuckets entries
+    BasicHistogram(size_t maxBuckets = defaultMaxBuckets) : maxBuckets(std::max<size_t>(maxBuckets, 1)), base(0), hashed(false), used(0) {}
+
+    // Count occurrences of a value, one by default, returns its new count
+    Count add(int value, Count occurrences = 1) {
+        if (!hashed) {
+            long long offset = static_cast<long long>(value) - base;
+            if (offset < 0 || offset >= static_cast<long long>(dense.size())) {
+                grow(value);
+                if (hashed) {
+                    return addHashed(value, occurrences);
+                }
+                offset = static_cast<long long>(value) - base;
+            }
+            return dense[static_cast<size_t>(offset)] += occurrences;
+        }
+        return addHashed(value, occurrences);
+    }
+
+    // Add every count of another histogram to this one
+    void merge(const BasicHistogram& other) {
+        other.forEach([this](int value, Count count) {
+            add(value, count);
+        });
+    }
+
+    // Call f(value, count) for every value counted at least once
+    template <typename Function>
+    void forEach(Function f) const {
+        if (hashed) {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                if (counts[i] != 0) {
+                    f(keys[i], counts[i]);
+                }
+            }
+        }
+        else {
+            for (size_t i = 0; i < dense.size(); ++i) {
+                if (dense[i] != 0) {
+                    f(static_cast<int>(base + static_cast<long long>(i)), dense[i]);
+                }
+            }
+        }
+    }
+
+    // Check whether the histogram has moved to the hash table
+    bool isHashed() const {
+        return hashed;
+    }
+};
+
+typedef BasicHistogram<uint32_t> Histogram;     // Counts a dataset in memory, whose int size a count cannot exceed
+typedef BasicHistogram<uint64_t> WideHistogram; // Counts a stream, which may hold any number of values
+
+size_t HistogramBudget::defaultMaxBuckets = HISTOGRAM_MAX_BUCKETS;
+
+// Function to count the set bits of a word
+inline int popcount64(unsigned long long word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Function to count the zero bits below the lowest set bit of a nonzero word
+inline int count_trailing_zeros64(unsigned long long word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    return popcount64((word & (0 - word)) - 1);
+#endif
+}
+
+class ResultWriter;
+
+// Base class for the typed result of one analyzer
+struct AnalysisResult {
+    // Virtual destructor to ensure proper cleanup
+    virtual ~AnalysisResult() {}
+
+    // Pass this result to the overload of the writer for its type
+    virtual void writeTo(ResultWriter& writer) const = 0;
+};
+
+// Value found at a fraction of the values in ascending order
+struct Quantile {
+    double fraction;    // Fraction of the values at or below the quantile, in [0, 1]
+    double value;       // Value at that fraction
+};
+
+// Result of a statistics analyzer
+struct StatisticsResult : AnalysisResult {
+    long long count;    // Number of values, no other field is set when zero
+    int min;            // Smallest value
+    int max;            // Largest value
+    double mean;        // Mean value
+    bool hasMedian;     // Whether the median was computed, it is not when streaming
+    double median;      // Median value
+    int mode;           // Most frequent value, the smallest of any tie
+    uint64_t modeCount; // Occurrences of the mode
+    std::vector<Quantile> quantiles;    // Quantiles in ascending order of fraction, empty when none were computed
+    double quantileError;   // Bound on the rank error of each quantile as a fraction of count, 0 when exact
+
+    // Constructor describes no values
+    StatisticsResult() : count(0), min(0), max(0), mean(0), hasMedian(false), median(0), mode(0), modeCount(0), quantileError(0) {}
+
+    void writeTo(ResultWriter& writer) const override;
+};
+
+// Result of a duplicate analyzer
+struct DuplicateResult : AnalysisResult {
+    long long duplicateCount;   // Values equal to one seen earlier
+    long long distinctCount;    // Number of distinct values, set only when estimated
+    double distinctError;       // Standard error of the estimate as a fraction of distinctCount, 0 when counted exactly
+
+    // Constructor records a duplicate count
+    explicit DuplicateResult(long long duplicateCount = 0) : duplicateCount(duplicateCount), distinctCount(0), distinctError(0) {}
+
+    void writeTo(ResultWriter& writer) const override;
+};
+
+// Result of a missing-value analyzer
+struct MissingResult : AnalysisResult {
+    long long missingCount;     // Values of the domain that never occurred
+    std::vector<std::pair<long long, long long>> ranges;    // First missing runs, as inclusive [first, last]
+    bool truncated;             // Whether more missing runs follow the ones listed
+
+    // Constructor describes no missing values
+    MissingResult() : missingCount(0), truncated(false) {}
+
+    void writeTo(ResultWriter& writer) const override;
+};
+
+// Result of a search analyzer
+struct SearchResult : AnalysisResult {
+    long long probes;       // Number of random values searched for
+    long long foundCount;   // Number of them found
+
+    // Constructor records the search outcome
+    SearchResult(long long probes = 0, long long foundCount = 0) : probes(probes), foundCount(foundCount) {}
+
+    void writeTo(ResultWriter& writer) const override;
+};
+
+// Values counted in one bucket of a footer histogram
+struct BucketCount {
+    long long low;              // Smallest value of the bucket
+    long long high;             // Largest value of the bucket
+    unsigned long long count;   // Values in [low, high]
+};
+
+// Result of a summary answered from a statistics footer alone
+struct FooterSummaryResult : AnalysisResult {
+    unsigned long long count;   // Number of values, no other field is set when zero
+    int min;                    // Smallest value
+    int max;                    // Largest value
+    double mean;                // Mean value
+    std::vector<BucketCount> buckets;   // Equal-width buckets over [min, max], in ascending order
+
+    // Constructor describes no values
+    FooterSummaryResult() : count(0), min(0), max(0), mean(0) {}
+
+    void writeTo(ResultWriter& writer) const override;
+};
+
+// Result of counting the values in a range, scanning only the footer blocks that overlap it partly
+struct RangeCountResult : AnalysisResult {
+    int low;                // Smallest value counted
+    int high;               // Largest value counted
+    unsigned long long foundCount;      // Values in [low, high]
+    unsigned long long blocksScanned;   // Blocks whose values were read
+    unsigned long long blockCount;      // Blocks in the footer
+
+    // Constructor records the count of [low, high]
+    RangeCountResult(int low = 0, int high = 0) : low(low), high(high), foundCount(0), blocksScanned(0), blockCount(0) {}
+
+    void writeTo(ResultWriter& writer) const override;
+};
+
+// Result of an analyzer that failed
+struct ErrorResult : AnalysisResult {
+    std::string message;    // Why the analyzer failed
+
+    // Constructor records the failure
+    explicit ErrorResult(const std::string& message) : message(message) {}
+
+    void writeTo(ResultWriter& writer) const override;
+};
+
+// Base class for serializing results, one overload per result type, grouped by the data file they describe
+class ResultWriter {
+protected:
+    std::ostream& out;  // Stream the results are written to
+
+public:
+    // Constructor writes to out
+    explicit ResultWriter(std::ostream& out) : out(out) {}
+
+    // Virtual destructor to ensure proper cleanup
+    virtual ~ResultWriter() {}
+
+    // Start the results of a data file
+    virtual void beginSource(const std::string& source) {
+        (void)source;
+    }
+
+    // Finish the results of a data file
+    virtual void endSource() {}
+
+    virtual void write(const StatisticsResult& result) = 0;
+    virtual void write(const DuplicateResult& result) = 0;
+    virtual void write(const MissingResult& result) = 0;
+    virtual void write(const SearchResult& result) = 0;
+    virtual void write(const ErrorResult& result) = 0;
+    virtual void write(const FooterSummaryResult& result) = 0;
+    virtual void write(const RangeCountResult& result) = 0;
+
+    // Create the writer for a format, naming each source in text when labelSources is set
+    static std::unique_ptr<ResultWriter> create(ResultFormat format, std::ostream& out, bool labelSources = false);
+};
+
+void StatisticsResult::writeTo(ResultWriter& writer) const { writer.write(*this); }
+void DuplicateResult::writeTo(ResultWriter& writer) const { writer.write(*this); }
+void MissingResult::writeTo(ResultWriter& writer) const { writer.write(*this); }
+void SearchResult::writeTo(ResultWriter& writer) const { writer.write(*this); }
+void ErrorResult::writeTo(ResultWriter& writer) const { writer.write(*this); }
+void FooterSummaryResult::writeTo(ResultWriter& writer) const { writer.write(*this); }
+void RangeCountResult::writeTo(ResultWriter& writer) const { writer.write(*this); }
+
+// Result writer for English sentences, one measure per line
+class TextResultWriter : public ResultWriter {
+    bool labelSources;  // Whether each source is named before its results, when there is more than one
+
+public:
+    // Constructor writes to out
+    explicit TextResultWriter(std::ostream& out, bool labelSources = false) : ResultWriter(out), labelSources(labelSources) {}
+
+    void beginSource(const std::string& source) override {
+        if (labelSources) {
+            out << "Results for " << source << "\n";
+        }
+    }
+
+    void endSource() override {
+        if (labelSources) {
+            out << "\n";
+        }
+    }
+
+    void write(const StatisticsResult& result) override {
+        if (result.count == 0) {
+            out << "No data to analyze.\n";   // Handle empty input case
+            return;
+        }
+        std::ostringstream text;    // Formats with default precision whatever the state of out
+        text << "The minimum value is " << result.min << "\n";
+        text << "The maximum value is " << result.max << "\n";
+        text << "The mean value is " << result.mean << "\n";
+        if (result.hasMedian) {
+            text << "The median value is " << result.median << "\n";
+        }
+        else if (result.quantiles.empty()) {
+            text << "The median value is not available when streaming\n";
+        }
+        for (const Quantile& quantile : result.quantiles) {
+            text << "The p" << quantile.fraction * 100 << " value is " << (result.quantileError > 0 ? "approximately " : "") << quantile.value << "\n";
+        }
+        if (result.quantileError > 0 && !result.quantiles.empty()) {
+            text << "Each approximate value lies within " << result.quantileError * 100 << "% of the values of its true rank\n";
+        }
+        text << "The mode value is " << result.mode << " which occurred " << result.modeCount << " times\n";
+        out << text.str();
+    }
+
+    void write(const DuplicateResult& result) override {
+        if (result.distinctError > 0) {
+            std::ostringstream text;    // Formats with default precision whatever the state of out
+            text << "There were approximately " << result.duplicateCount << " duplicated values and " << result.distinctCount
+                 << " distinct values, with a standard error of " << result.distinctError * 100 << "%\n";
+            out << text.str();
+            return;
+        }
+        out << "There were " << result.duplicateCount << " duplicated values\n";
+    }
+
+    void write(const MissingResult& result) override {
+        out << "There were " << result.missingCount << " missing values";
+        if (result.missingCount > 0) {
+            out << " in ranges";
+            for (size_t i = 0; i < result.ranges.size(); ++i) {
+                out << (i == 0 ? " " : ", ") << "[" << result.ranges[i].first << ", " << result.ranges[i].second << "]";
+            }
+            if (result.truncated) {
+                out << ", ...";
+            }
+        }
+        out << "\n";
+    }
+
+    void write(const SearchResult& result) override {
+        out << "There were " << result.foundCount << " random values found\n";
+    }
+
+    void write(const ErrorResult& result) override {
+        out << "Error: " << result.message << "\n";
+    }
+
+    void write(const FooterSummaryResult& result) override {
+        if (result.count == 0) {
+            out << "No data to analyze.\n";   // Handle empty file case
+            return;
+        }
+        std::ostringstream text;    // Formats with default precision whatever the state of out
+        text << "The minimum value is " << result.min << "\n";
+        text << "The maximum value is " << result.max << "\n";
+        text << "The mean value is " << result.mean << "\n";
+        text << "The values per bucket are";
+        for (size_t i = 0; i < result.buckets.size(); ++i) {
+            text << (i == 0 ? " " : ", ") << "[" << result.buckets[i].low << ", " << result.buckets[i].high << "]: " << result.buckets[i].count;
+        }
+        out << text.str() << "\n";
+    }
+
+    void write(const RangeCountResult& result) override {
+        out << "There were " << result.foundCount << " values in [" << result.low << ", " << result.high << "], scanning "
+            << result.blocksScanned << " of " << result.blockCount << " blocks\n";
+    }
+};
+
+// Result writer for one JSON object per data file, holding an array with one object per result
+class JsonResultWriter : public ResultWriter {
+    bool first;     // Whether no result of the current source has been written yet
+
+    // Helper function to write a string as a JSON string literal
+    void quote(const std::string& text) {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+            }
+            else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    // Helper function to open the object of one result
+    void open(const char* analyzer) {
+        out << (first ? "" : ",") << "{\"analyzer\":\"" << analyzer << "\"";
+        first = false;
+    }
+
+public:
+    // Constructor writes to out
+    explicit JsonResultWriter(std::ostream& out) : ResultWriter(out), first(true) {}
+
+    void beginSource(const std::string& source) override {
+        out << "{\"source\":";
+        quote(source);
+        out << ",\"results\":[";
+        first = true;
+    }
+
+    void endSource() override {
+        out << "]}\n";
+    }
+
+    void write(const StatisticsResult& result) override {
+        open("statistics");
+        out << ",\"count\":" << result.count;
+        if (result.count > 0) {
+            std::ostringstream mean;    // Round-trips the doubles exactly
+            mean << std::setprecision(17) << result.mean;
+            out << ",\"min\":" << result.min << ",\"max\":" << result.max << ",\"mean\":" << mean.str();
+            if (result.hasMedian) {
+                std::ostringstream median;
+                median << std::setprecision(17) << result.median;
+                out << ",\"median\":" << median.str();
+            }
+            out << ",\"mode\":" << result.mode << ",\"modeCount\":" << result.modeCount;
+            if (!result.quantiles.empty()) {
+                std::ostringstream quantiles; // Fractions as typed, values round-tripped exactly, as [fraction, value] pairs
+                quantiles << std::setprecision(17) << ",\"quantileError\":" << result.quantileError << ",\"quantiles\":[";
+                for (size_t i = 0; i < result.quantiles.size(); ++i) {
+                    quantiles << (i == 0 ? "" : ",") << "[" << std::setprecision(15) << result.quantiles[i].fraction
+                              << "," << std::setprecision(17) << result.quantiles[i].value << "]";
+                }
+                out << quantiles.str() << "]";
+            }
+        }
+        out << "}";
+    }
+
+    void write(const DuplicateResult& result) override {
+        open("duplicates");
+        out << ",\"duplicateCount\":" << result.duplicateCount;
+        if (result.distinctError > 0) {
+            std::ostringstream error;   // Round-trips the double exactly
+            error << std::setprecision(17) << result.distinctError;
+            out << ",\"distinctCount\":" << result.distinctCount << ",\"distinctError\":" << error.str();
+        }
+        out << "}";
+    }
+
+    void write(const MissingResult& result) override {
+        open("missing");
+        out << ",\"missingCount\":" << result.missingCount << ",\"ranges\":[";
+        for (size_t i = 0; i < result.ranges.size(); ++i) {
+            out << (i == 0 ? "" : ",") << "[" << result.ranges[i].first << "," << result.ranges[i].second << "]";
+        }
+        out << "],\"truncated\":" << (result.truncated ? "true" : "false") << "}";
+    }
+
+    void write(const SearchResult& result) override {
+        open("search");
+        out << ",\"probes\":" << result.probes << ",\"found\":" << result.foundCount << "}";
+    }
+
+    void write(const ErrorResult& result) override {
+        open("error");
+        out << ",\"message\":";
+        quote(result.message);
+        out << "}";
+    }
+
+    void write(const FooterSummaryResult& result) override {
+        open("summary");
+        out << ",\"count\":" << result.count;
+        if (result.count > 0) {
+            std::ostringstream mean;    // Round-trips the double exactly
+            mean << std::setprecision(17) << result.mean;
+            out << ",\"min\":" << result.min << ",\"max\":" << result.max << ",\"mean\":" << mean.str() << ",\"buckets\":[";
+            for (size_t i = 0; i < result.buckets.size(); ++i) {
+                out << (i == 0 ? "" : ",") << "[" << result.buckets[i].low << "," << result.buckets[i].high << "," << result.buckets[i].count << "]";
+            }
+            out << "]";
+        }
+        out << "}";
+    }
+
+    void write(const RangeCountResult& result) override {
+        open("rangeCount");
+        out << ",\"low\":" << result.low << ",\"high\":" << result.high << ",\"found\":" << result.foundCount
+            << ",\"blocksScanned\":" << result.blocksScanned << ",\"blockCount\":" << result.blockCount << "}";
+    }
+};
+
+// Result writer for compact records, each a one-byte tag followed by its fields in host byte order
+class BinaryResultWriter : public ResultWriter {
+public:
+    // Tags opening each record
+    enum Tag : uint8_t {
+        SourceTag = 1,      // uint32 length, then the source name
+        StatisticsTag = 2,  // int64 count, int32 min, int32 max, double mean, uint8 hasMedian, double median, int32 mode, uint64 modeCount
+        DuplicateTag = 3,   // int64 duplicateCount
+        MissingTag = 4,     // int64 missingCount, uint8 truncated, uint32 range count, then int64 first and last of each range
+        SearchTag = 5,      // int64 probes, int64 foundCount
+        ErrorTag = 6,       // uint32 length, then the message
+        EndTag = 7,         // No fields, closes the results of a source
+        QuantilesTag = 8,   // double quantileError, uint32 quantile count, then double fraction and value of each,
+                            // follows the statistics record it belongs to when it has quantiles
+        DistinctTag = 9,    // int64 distinctCount, double distinctError, follows the duplicate record it belongs to when estimated
+        SummaryTag = 10,    // uint64 count, int32 min, int32 max, double mean, uint32 bucket count, then int64 low,
+                            // int64 high and uint64 count of each bucket
+        RangeCountTag = 11  // int32 low, int32 high, uint64 foundCount, uint64 blocksScanned, uint64 blockCount
+    };
+
+private:
+    // Helper function to write the bytes of a value
+    template <typename T>
+    void put(const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    // Helper function to write a length-prefixed string
+    void putString(const std::string& text) {
+        put(static_cast<uint32_t>(text.size()));
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+public:
+    using ResultWriter::ResultWriter;
+
+    void beginSource(const std::string& source) override {
+        put(static_cast<uint8_t>(SourceTag));
+        putString(source);
+    }
+
+    void endSource() override {
+        put(static_cast<uint8_t>(EndTag));
+    }
+
+    void write(const StatisticsResult& result) override {
+        put(static_cast<uint8_t>(StatisticsTag));
+        put(static_cast<int64_t>(result.count));
+        put(static_cast<int32_t>(result.min));
+        put(static_cast<int32_t>(result.max));
+        put(result.mean);
+        put(static_cast<uint8_t>(result.hasMedian));
+        put(result.median);
+        put(static_cast<int32_t>(result.mode));
+        put(result.modeCount);
+        if (!result.quantiles.empty()) {
+            put(static_cast<uint8_t>(QuantilesTag));
+            put(result.quantileError);
+            put(static_cast<uint32_t>(result.quantiles.size()));
+            for (const Quantile& quantile : result.quantiles) {
+                put(quantile.fraction);
+                put(quantile.value);
+            }
+        }
+    }
+
+    void write(const DuplicateResult& result) override {
+        put(static_cast<uint8_t>(DuplicateTag));
+        put(static_cast<int64_t>(result.duplicateCount));
+        if (result.distinctError > 0) {
+            put(static_cast<uint8_t>(DistinctTag));
+            put(static_cast<int64_t>(result.distinctCount));
+            put(result.distinctError);
+        }
+    }
+
+    void write(const MissingResult& result) override {
+        put(static_cast<uint8_t>(MissingTag));
+        put(static_cast<int64_t>(result.missingCount));
+        put(static_cast<uint8_t>(result.truncated));
+        put(static_cast<uint32_t>(result.ranges.size()));
+        for (const std::pair<long long, long long>& range : result.ranges) {
+            put(static_cast<int64_t>(range.first));
+            put(static_cast<int64_t>(range.second));
+        }
+    }
+
+    void write(const SearchResult& result) override {
+        put(static_cast<uint8_t>(SearchTag));
+        put(static_cast<int64_t>(result.probes));
+        put(static_cast<int64_t>(result.foundCount));
+    }
+
+    void write(const ErrorResult& result) override {
+        put(static_cast<uint8_t>(ErrorTag));
+        putString(result.message);
+    }
+
+    void write(const FooterSummaryResult& result) override {
+        put(static_cast<uint8_t>(SummaryTag));
+        put(static_cast<uint64_t>(result.count));
+        put(static_cast<int32_t>(result.min));
+        put(static_cast<int32_t>(result.max));
+        put(result.mean);
+        put(static_cast<uint32_t>(result.buckets.size()));
+        for (const BucketCount& bucket : result.buckets) {
+            put(static_cast<int64_t>(bucket.low));
+            put(static_cast<int64_t>(bucket.high));
+            put(static_cast<uint64_t>(bucket.count));
+        }
+    }
+
+    void write(const RangeCountResult& result) override {
+        put(static_cast<uint8_t>(RangeCountTag));
+        put(static_cast<int32_t>(result.low));
+        put(static_cast<int32_t>(result.high));
+        put(static_cast<uint64_t>(result.foundCount));
+        put(static_cast<uint64_t>(result.blocksScanned));
+        put(static_cast<uint64_t>(result.blockCount));
+    }
+};
+
+std::unique_ptr<ResultWriter> ResultWriter::create(ResultFormat format, std::ostream& out, bool labelSources) {
+    switch (format) {
+    case ResultFormat::Json:
+        return std::unique_ptr<ResultWriter>(new JsonResultWriter(out));
+    case ResultFormat::Binary:
+        return std::unique_ptr<ResultWriter>(new BinaryResultWriter(out));
+    default:
+        return std::unique_ptr<ResultWriter>(new TextResultWriter(out, labelSources));
+    }
+}
+
+void StatisticsFooter::summarize(FooterSummaryResult& result) const {
+    if (blocks.empty()) return;  // Handle empty file case
+
+    long long sum = 0;
+    unsigned long long buckets[FOOTER_HISTOGRAM_BUCKETS] = {};
+    for (const BlockSummary& block : blocks) {
+        result.count += block.count;
+        sum += block.sum;
+        for (int bucket = 0; bucket < FOOTER_HISTOGRAM_BUCKETS; ++bucket) {
+            buckets[bucket] += block.histogram[bucket];
+        }
+    }
+
+    result.min = trailer.min;
+    result.max = trailer.max;
+    result.mean = static_cast<double>(sum) / result.count;
+    long long span = static_cast<long long>(trailer.max) - trailer.min + 1;
+    for (int bucket = 0; bucket < FOOTER_HISTOGRAM_BUCKETS; ++bucket) {
+        BucketCount range;
+        range.low = trailer.min + (span * bucket + FOOTER_HISTOGRAM_BUCKETS - 1) / FOOTER_HISTOGRAM_BUCKETS;
+        range.high = trailer.min + (span * (bucket + 1) + FOOTER_HISTOGRAM_BUCKETS - 1) / FOOTER_HISTOGRAM_BUCKETS - 1;
+        range.count = buckets[bucket];
+        if (range.low <= range.high) {  // Narrow value ranges leave some buckets empty
+            result.buckets.push_back(range);
+        }
+    }
+}
+
+// Class recording which values of a domain [low, high] occurred, one bit per value
+class PresenceBitset {
+    long long low;      // Smallest value of the domain
+    long long high;     // Largest value of the domain
+    std::vector<unsigned long long> words;  // Bit i is set once low + i occurred
+
+public:
+    // Constructor marks every value of [low, high] missing
+    PresenceBitset(long long low, long long high) : low(low), high(high), words(static_cast<size_t>((high - low + 1 + 63) / 64), 0) {
+        int padding = static_cast<int>(words.size() * 64 - (high - low + 1));
+        if (padding > 0) {
+            words.back() = ~0ULL << (64 - padding);    // Bits past high count as present, so they are never missing
+        }
+    }
+
+    // Mark a value present, values outside the domain are ignored
+    void set(int value) {
+        if (value >= low && value <= high) {
+            unsigned long long offset = static_cast<unsigned long long>(value - low);
+            words[offset / 64] |= 1ULL << (offset % 64);
+        }
+    }
+
+    // Count the values of the domain that never occurred
+    long long countMissing() const {
+        long long present = 0;
+        for (unsigned long long word : words) {
+            present += popcount64(word);
+        }
+        return static_cast<long long>(words.size()) * 64 - present;
+    }
+
+    // List the missing values as inclusive [first, last] runs, stopping after maxRanges runs
+    std::vector<std::pair<long long, long long>> missingRanges(size_t maxRanges) const {
+        std::vector<std::pair<long long, long long>> ranges;
+        bool inRun = false;
+        long long start = 0;
+        for (size_t i = 0; i < words.size() && ranges.size() < maxRanges; ++i) {
+            unsigned long long word = words[i];
+            long long wordStart = low + static_cast<long long>(i) * 64;
+            int bit = 0;
+            while (bit < 64 && ranges.size() < maxRanges) {
+                // Jump to the next bit that ends the current run or starts a new one
+                unsigned long long rest = (inRun ? word : ~word) >> bit;
+                if (rest == 0) {
+                    break;
+                }
+                bit += count_trailing_zeros64(rest);
+                if (inRun) {
+                    ranges.push_back(std::make_pair(start, wordStart + bit - 1));
+                }
+                else {
+                    start = wordStart + bit;
+                }
+                inRun = !inRun;
+            }
+        }
+        if (inRun && ranges.size() < maxRanges) {
+            ranges.push_back(std::make_pair(start, high));
+        }
+        return ranges;
+    }
+
+    // Summarize the missing count and the first missing ranges
+    std::unique_ptr<MissingResult> summarize() const {
+        std::unique_ptr<MissingResult> result(new MissingResult());
+        result->missingCount = countMissing();
+        result->ranges = missingRanges(MISSING_RANGES_SHOWN + 1);
+        if (result->ranges.size() > MISSING_RANGES_SHOWN) {
+            result->ranges.pop_back();
+            result->truncated = true;
+        }
+        return result;
+    }
+};
+
+// Results of one fused pass over the data, shared by every analyzer
+struct ScanSummary {
+    long long count;        // Number of values scanned
+    int min;                // Smallest value
+    int max;                // Largest value
+    double sum;             // Sum for mean calculation
+    long long duplicateCount;   // Values equal to one seen earlier
+    Histogram frequencyMap;     // Frequency of each value
+    PresenceBitset presence;    // Values of the expected domain that occurred
+
+    // Constructor starts with no values, tracking presence over [domainLow, domainHigh]
+    ScanSummary(long long domainLow, long long domainHigh) : count(0), min(0), max(0), sum(0), duplicateCount(0), presence(domainLow, domainHigh) {}
+
+    // Fold a block of values into every measure in a single pass
+    void add(const int* block, int size) {
+        if (count == 0 && size > 0) {
+            min = max = block[0];
+        }
+        for (int i = 0; i < size; ++i) {
+            int value = block[i];
+            min = std::min(min, value);
+            max = std::max(max, value);
+            sum += value;
+            if (frequencyMap.add(value) > 1) {
+                duplicateCount++;
+            }
+            presence.set(value);
+        }
+        count += size;
+    }
+};
+
+// Function to fold values into total, splitting them into contiguous partitions over up to threads workers of the
+// pool the caller runs on, each reduced into the partial make(part) returns and then merged into total in partition order.
+// Outside a pool the values are reduced on the calling thread alone. The caller and the queued tasks claim partitions
+// from a shared counter, so while waiting the caller reduces only its own unclaimed partitions, never foreign tasks.
+// An exception thrown by a partition is rethrown to the caller once every claimed partition is done
+template <typename Partial, typename MakePartial>
+void add_parallel(Partial& total, MakePartial make, const int* values, int size, int threads) {
+    ThreadPool* pool = ThreadPool::current();
+    int workers = pool != nullptr ? static_cast<int>(pool->getSize()) : 1;
+    int partitions = std::max(1, std::min(std::min(threads, workers), size / PARALLEL_MIN_PARTITION));
+    if (partitions == 1) {
+        total.add(values, size);
+        return;
+    }
+
+    // Progress shared with the queued tasks, which may start only after the caller has returned and must then do nothing
+    struct Progress {
+        std::atomic<int> next;          // Next partition not claimed yet
+        std::mutex mutex;               // Guards unfinished and failure
+        std::condition_variable done;   // Signalled when the last claimed partition is reduced
+        int unfinished;                 // Number of partitions not reduced yet
+        std::exception_ptr failure;     // First exception thrown by a partition, or null
+    };
+    std::shared_ptr<Progress> progress = std::make_shared<Progress>();
+    progress->next = 0;
+    progress->unfinished = partitions;
+
+    std::vector<Partial> partials;
+    partials.reserve(partitions);
+    for (int part = 0; part < partitions; ++part) {
+        partials.push_back(make(part));
+    }
+    Partial* partial = partials.data();
+    auto claim = [progress, partial, values, size, partitions] {
+        for (int part; (part = progress->next.fetch_add(1)) < partitions;) {
+            int first = static_cast<int>(static_cast<long long>(size) * part / partitions);
+            int last = static_cast<int>(static_cast<long long>(size) * (part + 1) / partitions);
+            std::exception_ptr failure;
+            try {
+                ScopedTimer timer("add_parallel partition");
+                partial[part].add(values + first, last - first);
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(progress->mutex);
+            if (failure && !progress->failure) {
+                progress->failure = failure;
+            }
+            if (--progress->unfinished == 0) {
+                progress->done.notify_one();
+            }
+        }
+    };
+    for (int part = 1; part < partitions; ++part) {
+        pool->submit(claim);
+    }
+    claim();    // The calling thread reduces partitions until none is left to claim
+
+    // Wait for the partitions other workers claimed
+    {
+        std::unique_lock<std::mutex> lock(progress->mutex);
+        progress->done.wait(lock, [&] { return progress->unfinished == 0; });
+    }
+    if (progress->failure) {
+        std::rethrow_exception(progress->failure);
+    }
+    for (const Partial& each : partials) {
+        total.merge(each);
+    }
+}
+
+// Statistical measures over a run of values, reduced one partition per thread and merged in partition order
+struct StatisticsPartial {
+    long long count;        // Number of values reduced
+    int min;                // Smallest value
+    int max;                // Largest value
+    long long sum;          // Exact sum, so merging in any grouping gives the same mean
+    Histogram frequencyMap; // Frequency of each value
+
+    // Constructor starts with no values
+    StatisticsPartial() : count(0), min(0), max(0), sum(0) {}
+
+    // Fold a run of values into every measure
+    void add(const int* values, int size) {
+        if (size <= 0) {
+            return;
+        }
+        long long runSum;
+        int runMin;
+        int runMax;
+        sum_min_max(values, size, runSum, runMin, runMax);
+        min = count == 0 ? runMin : std::min(min, runMin);
+        max = count == 0 ? runMax : std::max(max, runMax);
+        sum += runSum;
+        for (int i = 0; i < size; ++i) {
+            frequencyMap.add(values[i]);
+        }
+        count += size;
+    }
+
+    // Fold the measures of another partition into this one
+    void merge(const StatisticsPartial& other) {
+        if (other.count == 0) {
+            return;
+        }
+        min = count == 0 ? other.min : std::min(min, other.min);
+        max = count == 0 ? other.max : std::max(max, other.max);
+        sum += other.sum;
+        count += other.count;
+        frequencyMap.merge(other.frequencyMap);
+    }
+
+    // Fold values into every measure, splitting them into contiguous partitions over up to threads threads
+    void addParallel(const int* values, int size, int threads) {
+        add_parallel(*this, [](int) { return StatisticsPartial(); }, values, size, threads);
+    }
+};
+
+// Class estimating quantiles in one pass over the values and bounded memory, a KLL sketch (Karnin, Lang and Liberty).
+// A value held at level h stands for 2^h values added. When the sketch is full its lowest full level is sorted and one
+// value of each adjacent pair, the first or second alike for the whole level, moves up a level. Levels below the top
+// hold geometrically fewer values, so the sketch keeps O(k log(n / k)) values for n added, and the rank of a quantile
+// is off by at most about errorFor(k) * n with 99% confidence. Sketches of separate partitions merge level by level
+class QuantileSketch {
+    std::vector<std::vector<int>> levels;   // Values held at each level
+    std::vector<size_t> levelCapacity;      // Values each level holds before it may be compacted
+    int k;              // Capacity of the top level, which sets the error
+    size_t held;        // Number of values held over all levels
+    size_t capacity;    // Values the levels hold together before one is compacted
+    long long count;    // Number of values added
+    RandomGenerator random; // Picks which value of each pair moves up
+
+    // Helper function to size the levels after a level is added, shrinking by 2/3 for each level below the top
+    void updateCapacity() {
+        levelCapacity.resize(levels.size());
+        capacity = 0;
+        for (size_t level = 0; level < levels.size(); ++level) {
+            double shrunk = k * std::pow(2.0 / 3.0, static_cast<double>(levels.size() - 1 - level));
+            levelCapacity[level] = std::max(SKETCH_MIN_LEVEL_CAPACITY, static_cast<size_t>(std::ceil(shrunk)));
+            capacity += levelCapacity[level];
+        }
+    }
+
+    // Helper function to compact levels until the sketch is below its capacity
+    void compress() {
+        while (held >= capacity) {
+            // The levels cannot all be below their own capacity while together they are at or above the total
+            size_t level = 0;
+            while (levels[level].size() < levelCapacity[level]) {
+                level++;
+            }
+            if (level + 1 == levels.size()) {
+                levels.emplace_back();
+                updateCapacity();
+            }
+
+            // An odd value out stays behind, so that the weights held always add up to count
+            std::vector<int>& current = levels[level];
+            std::vector<int>& above = levels[level + 1];
+            std::sort(current.begin(), current.end());  // Levels are short, too short for counting or radix sort to pay off
+            size_t kept = current.size() % 2;
+            for (size_t i = kept + (random.next() & 1); i < current.size(); i += 2) {
+                above.push_back(current[i]);
+            }
+            held -= (current.size() - kept) / 2;
+            current.resize(kept);
+        }
+    }
+
+public:
+    // Constructor starts with no values, sized for a rank error of about error, drawing its choices from stream of seed
+    explicit QuantileSketch(double error = DEFAULT_QUANTILE_ERROR, uint64_t seed = 0, uint64_t stream = SKETCH_STREAM)
+        : levels(1), k(capacityFor(error)), held(0), capacity(0), count(0), random(seed, stream) {
+        updateCapacity();
+    }
+
+    // Get the top level capacity bounding the rank error by error, from the error model of the Apache DataSketches KLL sketch
+    static int capacityFor(double error) {
+        double k = std::pow(2.296 / error, 1 / 0.9723);
+        return static_cast<int>(std::min(std::max(std::ceil(k), static_cast<double>(SKETCH_MIN_LEVEL_CAPACITY)), 65535.0));
+    }
+
+    // Get the rank error, as a fraction of the values added, that a top level capacity of k keeps within with 99% confidence
+    static double errorFor(int k) {
+        return 2.296 / std::pow(static_cast<double>(k), 0.9723);
+    }
+
+    // Add a run of values
+    void add(const int* values, int size) {
+        while (size > 0) {
+            int taken = static_cast<int>(std::min<size_t>(static_cast<size_t>(size), capacity - held));
+            levels[0].insert(levels[0].end(), values, values + taken);
+            held += taken;
+            count += taken;
+            values += taken;
+            size -= taken;
+            compress();
+        }
+    }
+
+    // Fold the sketch of another partition into this one, both sized for the same error
+    void merge(const QuantileSketch& other) {
+        while (levels.size() < other.levels.size()) {
+            levels.emplace_back();
+        }
+        for (size_t level = 0; level < other.levels.size(); ++level) {
+            levels[level].insert(levels[level].end(), other.levels[level].begin(), other.levels[level].end());
+        }
+        held += other.held;
+        count += other.count;
+        updateCapacity();
+        compress();
+    }
+
+    // Estimate the value at each fraction of the values in ascending order, returned in the order of the fractions
+    std::vector<Quantile> quantiles(const double* fractions, size_t fractionCount) const {
+        std::vector<std::pair<int, long long>> weighted;    // Each value held with the number of values it stands for
+        weighted.reserve(held);
+        for (size_t level = 0; level < levels.size(); ++level) {
+            for (int value : levels[level]) {
+                weighted.push_back(std::make_pair(value, 1LL << level));
+            }
+        }
+        std::sort(weighted.begin(), weighted.end());
+
+        std::vector<Quantile> result(fractionCount);
+        for (size_t i = 0; i < fractionCount; ++i) {
+            // The quantile is the first value whose cumulative weight passes the zero-based rank fraction * (count - 1)
+            double rank = fractions[i] * static_cast<double>(count - 1);
+            long long cumulative = 0;
+            size_t j = 0;
+            while (j + 1 < weighted.size() && static_cast<double>(cumulative += weighted[j].second) <= rank) {
+                j++;
+            }
+            result[i].fraction = fractions[i];
+            result[i].value = weighted.empty() ? 0 : weighted[j].first;
+        }
+        return result;
+    }
+
+    // Getter for the rank error the sketch keeps within, as a fraction of the values added
+    double getError() const {
+        return errorFor(k);
+    }
+
+    // Getter for number of values added
+    long long getCount() const {
+        return count;
+    }
+};
+
+// Class estimating the number of distinct values in one pass and 2^precision bytes, a HyperLogLog sketch (Flajolet et al.).
+// Each value is hashed to 64 bits; the low precision bits pick a register, which keeps the largest position of the lowest
+// set bit among the remaining bits of the hashes it was picked by. The estimate has a standard error of about
+// 1.04 / sqrt(2^precision), 1.6% at the default 12 bits, over the whole range of counts, since it is read with Ertl's
+// improved estimator rather than switching between linear counting and the raw estimate, as --check-distinct verifies.
+// Sketches merge register by register
+class HyperLogLog {
+    std::vector<uint8_t> registers; // Largest bit position seen by each register, 0 when none
+    int precision;      // Number of hash bits picking a register
+    long long count;    // Number of values added
+
+    // Helper function to scatter the bits of a value over a 64-bit hash, the splitmix64 finalizer
+    static uint64_t hash(int value) {
+        uint64_t z = static_cast<uint32_t>(value) + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Helper function for the estimator, the sum over k >= 1 of x^(2^k) * 2^(k-1), plus x
+    static double sigma(double x) {
+        if (x == 1) {
+            return INFINITY;
+        }
+        double y = 1;
+        double z = x;
+        for (double previous = -1; z != previous;) {
+            x *= x;
+            previous = z;
+            z += x * y;
+            y += y;
+        }
+        return z;
+    }
+
+    // Helper function for the estimator, counting the registers at the largest bit position
+    static double tau(double x) {
+        if (x == 0 || x == 1) {
+            return 0;
+        }
+        double y = 1;
+        double z = 1 - x;
+        for (double previous = -1; z != previous;) {
+            x = std::sqrt(x);
+            previous = z;
+            y *= 0.5;
+            z -= (1 - x) * (1 - x) * y;
+        }
+        return z / 3;
+    }
+
+public:
+    // Constructor starts with no values and 2^precision registers
+    explicit HyperLogLog(int precision = DEFAULT_DISTINCT_PRECISION) : registers(static_cast<size_t>(1) << precision, 0), precision(precision), count(0) {}
+
+    // Add one value
+    void add(int value) {
+        uint64_t h = hash(value);
+        uint64_t rest = h >> precision;
+        uint8_t position = static_cast<uint8_t>(rest == 0 ? 64 - precision + 1 : count_trailing_zeros64(rest) + 1);
+        uint8_t& current = registers[h & (registers.size() - 1)];
+        current = std::max(current, position);
+        count++;
+    }
+
+    // Add a run of values
+    void add(const int* values, int size) {
+        for (int i = 0; i < size; ++i) {
+            add(values[i]);
+        }
+    }
+
+    // Fold the sketch of another partition into this one, both of the same precision, keeping the larger of each register
+    void merge(const HyperLogLog& other) {
+        uint8_t* into = registers.data();
+        const uint8_t* from = other.registers.data();
+        size_t size = registers.size();
+        size_t i = 0;
+#ifdef SIMD_X86
+        // SSE2 is part of every x86-64 processor, so the wide path needs no check
+        for (; i + 16 <= size; i += 16) {
+            __m128i wider = _mm_max_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(into + i)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(into + i), wider);
+        }
+#endif
+        for (; i < size; ++i) {
+            into[i] = std::max(into[i], from[i]);
+        }
+        count += other.count;
+    }
+
+    // Estimate the number of distinct values added
+    long long estimate() const {
+        int maxPosition = 64 - precision + 1;
+        std::vector<int> histogram(maxPosition + 1, 0);    // Number of registers at each bit position
+        for (uint8_t position : registers) {
+            histogram[position]++;
+        }
+        double m = static_cast<double>(registers.size());
+        double z = m * tau(1 - histogram[maxPosition] / m);
+        for (int position = maxPosition - 1; position >= 1; --position) {
+            z = 0.5 * (z + histogram[position]);
+        }
+        z += m * sigma(histogram[0] / m);
+        double distinct = m * m / (2 * std::log(2.0) * z);
+        return std::min(static_cast<long long>(std::llround(distinct)), count);  // There cannot be more distinct values than values
+    }
+
+    // Getter for the standard error of the estimate, as a fraction of it, with the constant Flajolet et al.
+    // give for few registers, which tends to 1.04 as they grow
+    double getError() const {
+        double constant = precision <= 4 ? 1.106 : precision == 5 ? 1.070 : precision == 6 ? 1.054 : precision == 7 ? 1.046 : 1.04;
+        return constant / std::sqrt(static_cast<double>(registers.size()));
+    }
+
+    // Getter for number of values added
+    long long getCount() const {
+        return count;
+    }
+};
+
+// Class holding the values of one file, shared by every analyzer
+class Dataset {
+    BinaryReader reader;        // Raw values, read or mapped from the file
+    std::vector<int> ownSorted; // Storage for the sorted copy unless the caller lends some
+    std::vector<int>& sorted;   // Sorted copy of the values, built on first request
+    std::once_flag sortedOnce;  // Builds the sorted copy once, even when requested from several threads
+    std::atomic<bool> sortedBuilt;  // Whether the sorted copy has been requested and built
+    long long domainLow;        // Smallest value expected in the data
+    long long domainHigh;       // Largest value expected in the data
+    std::unique_ptr<ScanSummary> summary;   // Results of the fused pass, built with its domain-sized bitset on first request
+    std::once_flag scannedOnce; // Runs the fused pass once, even when requested from several threads
+
+public:
+    // Constructor reads values from binary file, or maps it when mapped is set, expecting values in [domainLow, domainHigh],
+    // and builds the sorted copy in sortedStorage when given so that its capacity carries over from file to file
+    Dataset(const std::string& name, bool mapped = false, long long domainLow = 0, long long domainHigh = DOMAIN_SIZE - 1,
+            std::vector<int>* sortedStorage = nullptr)
+        : reader(name, mapped), sorted(sortedStorage != nullptr ? *sortedStorage : ownSorted),
+          sortedBuilt(false), domainLow(domainLow), domainHigh(domainHigh) {}
+
+    // Getter for values in file order
+    const int* getValues() const {
+        return reader.getValues();
+    }
+
+    // Getter for values in ascending order, sorted once and cached
+    const int* getSortedValues() {
+        std::call_once(sortedOnce, [this] {
+            ScopedTimer timer("Dataset sort");
+            sorted.assign(reader.getValues(), reader.getValues() + reader.getSize());
+            sort_values(sorted.data(), getSize());
+            sortedBuilt = true;
+        });
+        return sorted.data();
+    }
+
+    // Check whether the sorted copy already exists, so that reading ranks from it costs nothing more
+    bool hasSortedValues() const {
+        return sortedBuilt;
+    }
+
+    // Getter for the results of one fused pass over the values, scanned once and cached
+    const ScanSummary& getSummary() {
+        std::call_once(scannedOnce, [this] {
+            ScopedTimer timer("Dataset fused scan");
+            summary.reset(new ScanSummary(domainLow, domainHigh));
+            summary->add(reader.getValues(), getSize());
+        });
+        return *summary;
+    }
+
+    // Getter for size of array
+    int getSize() const {
+        return reader.getSize();
+    }
+
+    // Getter for smallest value expected in the data
+    long long getDomainLow() const {
+        return domainLow;
+    }
+
+    // Getter for largest value expected in the data
+    long long getDomainHigh() const {
+        return domainHigh;
+    }
+};
+
+// Class viewing an array of values without owning it, standing in for std::span<const int> before C++20
+class ValueSpan {
+    const int* first;   // First value, or nullptr when empty
+    int count;          // Number of values
+
+public:
+    // Constructor views count values starting at first
+    ValueSpan(const int* first = nullptr, int count = 0) : first(first), count(count) {}
+
+    // Getter for the first value
+    const int* data() const {
+        return first;
+    }
+
+    // Getter for number of values
+    int size() const {
+        return count;
+    }
+
+    // Check whether there are no values
+    bool empty() const {
+        return count == 0;
+    }
+
+    // Access the value at index
+    const int& operator[](int index) const {
+        return first[index];
+    }
+
+    // Iterators for range-based for loops
+    const int* begin() const {
+        return first;
+    }
+
+    const int* end() const {
+        return first + count;
+    }
+};
+
+// How an analyzer needs to access the values it is given
+enum class ValueAccess {
+    ReadOnly,   // Values are only scanned, so they are viewed in place
+    Mutable     // Values are reordered, so the analyzer works on its own copy
+};
+
+// Base class for data analysis
+class Analyzer {
+protected:
+    ValueSpan values;   // Values analyzed, viewed in place or in buffer
+    int* buffer;        // Owned copy of the values when access is mutable, or nullptr
+    const ScanSummary* summary; // Shared fused pass to derive results from, or nullptr to scan independently
+
+public:
+    // Constructor views the values in place, copying them only when the analyzer declares mutable access
+    explicit Analyzer(ValueSpan values, ValueAccess access = ValueAccess::ReadOnly) : values(values), buffer(nullptr), summary(nullptr) {
+        if (access == ValueAccess::Mutable) {
+            buffer = new int[values.size()];
+            std::copy(values.begin(), values.end(), buffer);
+            this->values = ValueSpan(buffer, values.size());
+        }
+    }
+
+    Analyzer(const Analyzer&) = delete;
+    Analyzer& operator=(const Analyzer&) = delete;
+
+    // Virtual destructor to ensure proper cleanup
+    virtual ~Analyzer() {
+        delete[] buffer;
+    }
+
+    // Virtual function to be overridden by derived classes
+    virtual std::unique_ptr<AnalysisResult> analyze() = 0;
+};
+
+// Derived class for statistical analysis
+class StatisticsAnalyzer : public Analyzer {
+    int threads;            // Number of threads the reductions are split over
+    double quantileError;   // Rank error of the quantiles estimated by a sketch, or 0 to find them exactly
+    bool selecting;         // Whether exact quantiles are selected from an unsorted copy instead of read from sorted values
+    std::vector<double> fractions;  // Fractions of the values, ascending, whose quantiles are reported besides the median
+    uint64_t seed;          // Seed of the random streams the quantile sketches draw from
+
+    // Helper function to get the exact value at each fraction of the values in ascending order, interpolating linearly
+    // between the two values around the zero-based rank fraction * (size - 1)
+    std::vector<double> exactQuantiles(const std::vector<double>& wanted) {
+        int size = values.size();
+        std::vector<int> ranks;
+        for (double fraction : wanted) {
+            int lower = static_cast<int>(fraction * (size - 1));
+            ranks.push_back(lower);
+            ranks.push_back(std::min(lower + 1, size - 1));
+        }
+        std::sort(ranks.begin(), ranks.end());
+        ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+
+        std::vector<int> rankValues;
+        if (selecting) {
+            rankValues = select_ranks(buffer, size, ranks);
+        }
+        else {
+            for (int rank : ranks) {
+                rankValues.push_back(values[rank]);
+            }
+        }
+        auto valueAt = [&](int rank) {
+            return static_cast<double>(rankValues[std::lower_bound(ranks.begin(), ranks.end(), rank) - ranks.begin()]);
+        };
+
+        std::vector<double> found;
+        for (double fraction : wanted) {
+            double position = fraction * (size - 1);
+            int lower = static_cast<int>(position);
+            double low = valueAt(lower);
+            found.push_back(low + (valueAt(std::min(lower + 1, size - 1)) - low) * (position - lower));
+        }
+        return found;
+    }
+
+    // Helper function to check whether exact quantiles are selected, which is only worth it while the dataset is unsorted
+    static bool selects(const Dataset& data, bool selecting) {
+        return selecting && !data.hasSortedValues();
+    }
+
+public:
+    // Constructor copies and sorts the values, since exact quantiles need them in order, or only copies them when
+    // selecting is set, or views them in place when the quantiles are estimated by a sketch of rank error quantileError.
+    // Besides the median the quantiles at fractions are reported, or those at SKETCHED_QUANTILES when sketching without any.
+    // The sketches draw their choices from seed
+    explicit StatisticsAnalyzer(ValueSpan values, int threads = 1, double quantileError = 0, bool selecting = false,
+                                const std::vector<double>& fractions = std::vector<double>(), uint64_t seed = 0)
+        : Analyzer(values, quantileError > 0 ? ValueAccess::ReadOnly : ValueAccess::Mutable), threads(threads),
+          quantileError(quantileError), selecting(selecting && quantileError == 0), fractions(fractions), seed(seed) {
+        ScopedTimer timer("StatisticsAnalyzer constructor");
+        if (buffer != nullptr && !this->selecting) {
+            sort_values(buffer, this->values.size());
+        }
+        if (quantileError > 0 && this->fractions.empty()) {
+            this->fractions.assign(std::begin(SKETCHED_QUANTILES), std::end(SKETCHED_QUANTILES));
+        }
+    }
+
+    // Constructor views the shared sorted copy of the dataset, or copies its values in file order when selecting is set
+    // and nothing has sorted them yet, or views them in place when the quantiles are estimated by a sketch of rank error
+    // quantileError, drawing its choices from seed, and views its fused pass when fused is set
+    StatisticsAnalyzer(Dataset& data, bool fused = false, int threads = 1, double quantileError = 0, bool selecting = false,
+                       const std::vector<double>& fractions = std::vector<double>(), uint64_t seed = 0)
+        : Analyzer(ValueSpan(quantileError > 0 || selects(data, selecting) ? data.getValues() : data.getSortedValues(), data.getSize()),
+                   quantileError == 0 && selects(data, selecting) ? ValueAccess::Mutable : ValueAccess::ReadOnly),
+          threads(threads), quantileError(quantileError), selecting(quantileError == 0 && selects(data, selecting)), fractions(fractions),
+          seed(seed) {
+        ScopedTimer timer("StatisticsAnalyzer constructor");
+        if (fused) {
+            summary = &data.getSummary();
+        }
+        if (quantileError > 0 && this->fractions.empty()) {
+            this->fractions.assign(std::begin(SKETCHED_QUANTILES), std::end(SKETCHED_QUANTILES));
+        }
+    }
+
+    // Analyze method computes statistical measures
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("StatisticsAnalyzer::analyze");
+        std::unique_ptr<StatisticsResult> result(new StatisticsResult());
+        int size = values.size();
+        if (size == 0) return result;  // Handle empty array case
+
+        int min = values[0];    // Initialize min value
+        int max = values[size - 1]; // Initialize max value
+        double sum = 0; // Initialize sum for mean calculation
+
+        // Map to store frequency of each value, taken from the fused pass when there is one
+        StatisticsPartial local;
+        const Histogram* frequencyMap = &local.frequencyMap;
+        if (summary != nullptr) {
+            min = summary->min;
+            max = summary->max;
+            sum = summary->sum;
+            frequencyMap = &summary->frequencyMap;
+        }
+        else {
+            local.addParallel(values.data(), size, threads);
+            min = local.min;
+            max = local.max;
+            sum = static_cast<double>(local.sum);
+        }
+
+        double mean = sum / size;   // Calculate mean
+
+        // Calculate median and the other quantiles exactly, or estimate them in one more pass with a sketch
+        if (quantileError > 0) {
+            // Each partition draws from a stream of its own, so that partitions do not compact in lockstep
+            QuantileSketch sketch(quantileError, seed);
+            add_parallel(sketch, [this](int part) { return QuantileSketch(quantileError, seed, SKETCH_STREAM + 1 + part); },
+                         values.data(), size, threads);
+            result->quantiles = sketch.quantiles(fractions.data(), fractions.size());
+            result->quantileError = sketch.getError();
+        }
+        else {
+            std::vector<double> wanted(1, 0.5);
+            wanted.insert(wanted.end(), fractions.begin(), fractions.end());
+            std::vector<double> found = exactQuantiles(wanted);
+            result->hasMedian = true;
+            result->median = found[0];
+            for (size_t i = 0; i < fractions.size(); ++i) {
+                Quantile quantile;
+                quantile.fraction = fractions[i];
+                quantile.value = found[i + 1];
+                result->quantiles.push_back(quantile);
+            }
+        }
+
+        // Calculate mode
+        int mode = values[0];
+        uint32_t maxFrequency = 1;
+        frequencyMap->forEach([&](int value, uint32_t count) {
+            if (count > maxFrequency || (count == maxFrequency && value < mode)) {  // Ties go to the smallest value
+                maxFrequency = count;
+                mode = value;
+            }
+        });
+
+        // Prepare result
+        result->count = size;
+        result->min = min;
+        result->max = max;
+        result->mean = mean;
+        result->mode = mode;
+        result->modeCount = maxFrequency;
+
+        return result;
+    }
+};
+
+// Derived class for detecting duplicated values
+class DuplicateAnalyzer : public Analyzer {
+    int threads;            // Number of threads an estimate is split over
+    int distinctPrecision;  // Register bits of the sketch estimating distinct values, or 0 to count duplicates exactly
+
+public:
+    // Constructor views the values in place, since they are only scanned, estimating with a sketch of 2^distinctPrecision
+    // registers in place of an exact count unless distinctPrecision is 0
+    explicit DuplicateAnalyzer(ValueSpan values, int threads = 1, int distinctPrecision = 0)
+        : Analyzer(values), threads(threads), distinctPrecision(distinctPrecision) {}
+
+    // Constructor views the values of the dataset, and its fused pass when fused is set, which an estimate does not use
+    DuplicateAnalyzer(Dataset& data, bool fused = false, int threads = 1, int distinctPrecision = 0)
+        : Analyzer(ValueSpan(data.getValues(), data.getSize())), threads(threads), distinctPrecision(distinctPrecision) {
+        ScopedTimer timer("DuplicateAnalyzer constructor");
+        if (fused) {
+            summary = &data.getSummary();
+        }
+    }
+
+    // Analyze method counts duplicated values, or estimates them as the values less the distinct ones
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("DuplicateAnalyzer::analyze");
+        if (distinctPrecision > 0) {
+            HyperLogLog sketch(distinctPrecision);
+            add_parallel(sketch, [this](int) { return HyperLogLog(distinctPrecision); }, values.data(), values.size(), threads);
+            std::unique_ptr<DuplicateResult> result(new DuplicateResult());
+            result->distinctCount = sketch.estimate();
+            result->duplicateCount = values.size() - result->distinctCount;
+            result->distinctError = sketch.getError();
+            return result;
+        }
+
+        long long duplicateCount = 0;
+        if (summary != nullptr) {
+            duplicateCount = summary->duplicateCount;
+        }
+        else {
+            Histogram countMap;
+            for (int value : values) {
+                countMap.add(value);
+            }
+
+            countMap.forEach([&](int, uint32_t count) {
+                duplicateCount += count - 1;
+            });
+        }
+
+        return std::unique_ptr<AnalysisResult>(new DuplicateResult(duplicateCount));
+    }
+};
+
+// Derived class for detecting missing values
+class MissingAnalyzer : public Analyzer {
+    long long domainLow;    // Smallest value expected in the data
+    long long domainHigh;   // Largest value expected in the data
+
+public:
+    // Constructor views the values in place, since they are only scanned
+    explicit MissingAnalyzer(ValueSpan values, long long domainLow = 0, long long domainHigh = DOMAIN_SIZE - 1)
+        : Analyzer(values), domainLow(domainLow), domainHigh(domainHigh) {}
+
+    // Constructor views the values and domain of the dataset, and its fused pass when fused is set
+    MissingAnalyzer(Dataset& data, bool fused = false)
+        : Analyzer(ValueSpan(data.getValues(), data.getSize())), domainLow(data.getDomainLow()), domainHigh(data.getDomainHigh()) {
+        ScopedTimer timer("MissingAnalyzer constructor");
+        if (fused) {
+            summary = &data.getSummary();
+        }
+    }
+
+    // Analyze method counts missing values and lists the ranges they form
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("MissingAnalyzer::analyze");
+        if (summary != nullptr) {
+            return summary->presence.summarize();
+        }
+
+        PresenceBitset presence(domainLow, domainHigh);
+        for (int value : values) {
+            presence.set(value);
+        }
+        return presence.summarize();
+    }
+};
+
+// Function to hint that memory at address will be read soon
+inline void prefetch_read(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+}
+
+// Class holding sorted values in Eytzinger (breadth-first) order for cache-friendly batch search,
+// where the children of node k are 2k and 2k + 1 and the root is node 1
+class EytzingerIndex {
+    std::vector<int> nodes; // Values in breadth-first order, nodes[0] unused
+    size_t size;            // Number of values
+    int levels;             // Number of tree levels, the last possibly partial
+
+    // Helper function to fill the subtree rooted at node k by an in-order walk over the sorted values
+    void build(const int* sorted, size_t& next, size_t k) {
+        if (k <= size) {
+            build(sorted, next, 2 * k);
+            nodes[k] = sorted[next++];
+            build(sorted, next, 2 * k + 1);
+        }
+    }
+
+public:
+    // Constructor creates an empty index
+    EytzingerIndex() : nodes(1), size(0), levels(0) {}
+
+    // Constructor lays out size sorted values
+    EytzingerIndex(const int* sorted, size_t size) : nodes(size + 1), size(size), levels(0) {
+        size_t next = 0;
+        build(sorted, next, 1);
+        while ((static_cast<size_t>(1) << levels) <= size) {
+            levels++;
+        }
+    }
+
+    // Check whether each key occurs, storing 1 or 0 per key in found, returns the number found
+    size_t containsBatch(const std::vector<int>& keys, std::vector<unsigned char>& found) const {
+        found.assign(keys.size(), 0);
+        if (size == 0) {
+            return 0;
+        }
+
+        const int* tree = nodes.data();
+        size_t foundCount = 0;
+        size_t position[SEARCH_BATCH_WIDTH];
+        for (size_t first = 0; first < keys.size(); first += SEARCH_BATCH_WIDTH) {
+            size_t width = std::min(SEARCH_BATCH_WIDTH, keys.size() - first);
+            const int* batch = keys.data() + first;
+            for (size_t j = 0; j < width; ++j) {
+                position[j] = 1;
+            }
+
+            // Every level but the last is full, so all searches in the batch descend in lockstep
+            // without bounds checks, each prefetching the cache line of its descendants four levels down
+            for (int level = 1; level < levels; ++level) {
+                for (size_t j = 0; j < width; ++j) {
+                    size_t k = position[j];
+                    prefetch_read(tree + std::min(k * 16, size));
+                    position[j] = 2 * k + (tree[k] < batch[j]);
+                }
+            }
+
+            for (size_t j = 0; j < width; ++j) {
+                size_t k = position[j];
+                if (k <= size) {
+                    k = 2 * k + (tree[k] < batch[j]);
+                }
+                // Undo the right turns taken after the last left turn to land on the lower bound
+                k >>= count_trailing_zeros64(~static_cast<unsigned long long>(k)) + 1;
+                if (k != 0 && tree[k] == batch[j]) {
+                    found[first + j] = 1;
+                    foundCount++;
+                }
+            }
+        }
+        return foundCount;
+    }
+};
+
+// Header of a sidecar search index file
+struct IndexHeader {
+    char magic[4];              // INDEX_MAGIC
+    uint32_t version;           // Index format version
+    uint64_t sourceLength;      // Length of the data file when indexed
+    int64_t sourceModified;     // Modification time of the data file when indexed
+    uint64_t distinctCount;     // Number of distinct values
+    uint32_t blockValues;       // Distinct values per block but the last
+    uint32_t reserved;          // Zero, keeps the offsets aligned
+    uint64_t blockCount;        // Number of blocks
+    uint64_t fenceOffset;       // Byte offset of the first value of each block, as int32
+    uint64_t blockOffsetsOffset;    // Byte offset of the start of each block's deltas, as uint64, plus the end
+    uint64_t dataOffset;        // Byte offset of the delta-coded blocks
+};
+
+static_assert(sizeof(IndexHeader) == 72, "IndexHeader must match its on-disk layout");
+
+// Class for a persistent search index stored next to a data file as <name>.idx, holding its distinct values
+// sorted in blocks whose first value sits in a fence array and whose other values are varint deltas
+class SidecarIndex {
+    MappedFile mapping;             // Mapping of the index file
+    const IndexHeader* header;      // Header in the mapping
+    const int* fences;              // First value of each block
+    const uint64_t* blockOffsets;   // Offset of each block's deltas within data, plus the end
+    const unsigned char* data;      // Delta-coded blocks
+
+    // Helper function to append a value as an LEB128 varint
+    static void appendVarint(std::vector<unsigned char>& out, unsigned int value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    // Helper function to build the index of a data file and write it to indexName
+    static void build(const std::string& sourceName, const std::string& indexName) {
+        unsigned long long sourceLength;
+        long long sourceModified;
+        file_stamp(sourceName, sourceLength, sourceModified);
+
+        std::vector<int> distinct;
+        {
+            BinaryReader reader(sourceName, true);
+            distinct.assign(reader.getValues(), reader.getValues() + reader.getSize());
+        }
+        sort_values(distinct.data(), static_cast<int>(distinct.size()));
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+        IndexHeader layout = IndexHeader();
+        std::memcpy(layout.magic, INDEX_MAGIC, sizeof(layout.magic));
+        layout.version = INDEX_VERSION;
+        layout.sourceLength = sourceLength;
+        layout.sourceModified = sourceModified;
+        layout.distinctCount = distinct.size();
+        layout.blockValues = INDEX_BLOCK_VALUES;
+        layout.blockCount = (distinct.size() + INDEX_BLOCK_VALUES - 1) / INDEX_BLOCK_VALUES;
+
+        std::vector<int> blockFences(static_cast<size_t>(layout.blockCount));
+        std::vector<uint64_t> offsets;
+        std::vector<unsigned char> deltas;
+        for (size_t block = 0; block < blockFences.size(); ++block) {
+            size_t first = block * INDEX_BLOCK_VALUES;
+            size_t last = std::min<size_t>(first + INDEX_BLOCK_VALUES, distinct.size());
+            blockFences[block] = distinct[first];
+            offsets.push_back(deltas.size());
+            for (size_t i = first + 1; i < last; ++i) {
+                appendVarint(deltas, static_cast<unsigned int>(distinct[i]) - static_cast<unsigned int>(distinct[i - 1]));
+            }
+        }
+        offsets.push_back(deltas.size());
+
+        // Pad the fences to 8 bytes so that the block offsets after them stay aligned in the mapping
+        size_t fenceBytes = (blockFences.size() * sizeof(int) + 7) / 8 * 8;
+        layout.fenceOffset = sizeof(IndexHeader);
+        layout.blockOffsetsOffset = layout.fenceOffset + fenceBytes;
+        layout.dataOffset = layout.blockOffsetsOffset + offsets.size() * sizeof(uint64_t);
+
+        std::ofstream outFile(indexName, std::ios::binary | std::ios::trunc);
+        if (!outFile) {
+            throw std::runtime_error("Cannot create " + indexName);
+        }
+        std::vector<char> padding(fenceBytes - blockFences.size() * sizeof(int), 0);
+        outFile.write(reinterpret_cast<const char*>(&layout), sizeof(layout));
+        outFile.write(reinterpret_cast<const char*>(blockFences.data()), static_cast<std::streamsize>(blockFences.size() * sizeof(int)));
+        outFile.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        outFile.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+        outFile.write(reinterpret_cast<const char*>(deltas.data()), static_cast<std::streamsize>(deltas.size()));
+        outFile.close();
+        if (!outFile) {
+            throw std::runtime_error("Cannot write " + indexName);
+        }
+    }
+
+    // Helper function to map an index file, returns false when it is missing, malformed or older than the data file
+    bool open(const std::string& sourceName, const std::string& indexName) {
+        try {
+            mapping.open(indexName);
+        }
+        catch (const std::runtime_error&) {
+            return false;   // No index yet
+        }
+        if (mapping.getLength() < sizeof(IndexHeader)) {
+            return false;
+        }
+        header = reinterpret_cast<const IndexHeader*>(mapping.getData());
+        unsigned long long sourceLength;
+        long long sourceModified;
+        file_stamp(sourceName, sourceLength, sourceModified);
+        if (std::memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 || header->version != INDEX_VERSION
+            || header->sourceLength != sourceLength || header->sourceModified != sourceModified
+            || header->blockValues == 0 || header->blockCount != (header->distinctCount + header->blockValues - 1) / header->blockValues
+            || header->dataOffset > mapping.getLength()
+            || header->blockOffsetsOffset + (header->blockCount + 1) * sizeof(uint64_t) > header->dataOffset
+            || header->fenceOffset + header->blockCount * sizeof(int) > header->blockOffsetsOffset) {
+            return false;
+        }
+        fences = reinterpret_cast<const int*>(mapping.getData() + header->fenceOffset);
+        blockOffsets = reinterpret_cast<const uint64_t*>(mapping.getData() + header->blockOffsetsOffset);
+        data = reinterpret_cast<const unsigned char*>(mapping.getData() + header->dataOffset);
+        if (blockOffsets[header->blockCount] > mapping.getLength() - header->dataOffset) {
+            return false;
+        }
+        return true;
+    }
+
+public:
+    // Constructor creates an empty index
+    SidecarIndex() : header(nullptr), fences(nullptr), blockOffsets(nullptr), data(nullptr) {}
+
+    // Map the index of a data file, building it first when it is missing or stale
+    void openOrBuild(const std::string& sourceName) {
+        std::string indexName = sourceName + ".idx";
+        if (!open(sourceName, indexName)) {
+            mapping.close();
+            ScopedTimer timer("SidecarIndex build");
+            build(sourceName, indexName);
+            if (!open(sourceName, indexName)) {
+                throw std::runtime_error("Cannot open the index just built at " + indexName);
+            }
+        }
+    }
+
+    // Check whether a key occurs, decoding only the one block whose fences bracket it
+    bool contains(int key) const {
+        size_t blockCount = static_cast<size_t>(header->blockCount);
+        const int* next = std::upper_bound(fences, fences + blockCount, key);
+        if (next == fences) {
+            return false;
+        }
+        size_t block = static_cast<size_t>(next - fences) - 1;
+        unsigned int value = static_cast<unsigned int>(fences[block]);
+        const unsigned char* delta = data + blockOffsets[block];
+        const unsigned char* end = data + blockOffsets[block + 1];
+        while (static_cast<int>(value) < key && delta < end) {
+            unsigned int step = 0;
+            for (int shift = 0; delta < end; shift += 7) {
+                step |= static_cast<unsigned int>(*delta & 0x7F) << shift;
+                if ((*delta++ & 0x80) == 0) {
+                    break;
+                }
+            }
+            value += step;
+        }
+        return static_cast<int>(value) == key;
+    }
+
+    // Check whether each key occurs, storing 1 or 0 per key in found, returns the number found
+    size_t containsBatch(const std::vector<int>& keys, std::vector<unsigned char>& found) const {
+        found.assign(keys.size(), 0);
+        size_t foundCount = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (contains(keys[i])) {
+                found[i] = 1;
+                foundCount++;
+            }
+        }
+        return foundCount;
+    }
+};
+
+// Derived class for searching random values
+class SearchAnalyzer : public Analyzer {
+    EytzingerIndex index;   // Sorted values laid out for batch search
+    const SidecarIndex* sidecar;    // Persistent index searched instead, or nullptr to search the values
+    int probes;             // Number of random values searched for
+    ValueDistribution keys; // Spreads the values searched for uniformly over the domain
+    RandomGenerator random; // Draws the values searched for
+
+public:
+    // Constructor copies and sorts the values, then lays out the search index, searching for values in [domainLow, domainHigh]
+    explicit SearchAnalyzer(ValueSpan values, int probes = SEARCH_PROBES, uint64_t seed = 0, long long domainLow = 0,
+                            long long domainHigh = DOMAIN_SIZE - 1)
+        : Analyzer(values, ValueAccess::Mutable), sidecar(nullptr), probes(probes),
+          keys(Distribution::Uniform, domainLow, domainHigh, static_cast<uint64_t>(probes)), random(seed, SEARCH_STREAM) {
+        ScopedTimer timer("SearchAnalyzer constructor");
+        sort_values(buffer, this->values.size());
+        index = EytzingerIndex(buffer, this->values.size());
+    }
+
+    // Constructor views the shared sorted copy of the dataset to lay out the search index,
+    // or searches the sidecar index without touching the dataset when one is given, for values in the dataset's domain
+    SearchAnalyzer(Dataset& data, int probes = SEARCH_PROBES, const SidecarIndex* sidecar = nullptr, uint64_t seed = 0)
+        : Analyzer(sidecar != nullptr ? ValueSpan() : ValueSpan(data.getSortedValues(), data.getSize())),
+          sidecar(sidecar), probes(probes), keys(Distribution::Uniform, data.getDomainLow(), data.getDomainHigh(), static_cast<uint64_t>(probes)),
+          random(seed, SEARCH_STREAM) {
+        ScopedTimer timer("SearchAnalyzer constructor");
+        index = EytzingerIndex(this->values.data(), this->values.size());
+    }
+
+    // Constructor searches the sidecar index alone for values in [domainLow, domainHigh], for runs that need no other
+    // view of the values
+    SearchAnalyzer(const SidecarIndex& sidecar, int probes = SEARCH_PROBES, uint64_t seed = 0, long long domainLow = 0,
+                   long long domainHigh = DOMAIN_SIZE - 1)
+        : Analyzer(ValueSpan()), sidecar(&sidecar), probes(probes),
+          keys(Distribution::Uniform, domainLow, domainHigh, static_cast<uint64_t>(probes)), random(seed, SEARCH_STREAM) {}
+
+    // Analyze method searches for random values in one batch
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("SearchAnalyzer::analyze");
+        std::vector<int> searchValues(probes);
+        keys.fill(searchValues.data(), searchValues.size(), 0, random);
+        std::vector<unsigned char> found;
+        size_t foundCount = sidecar != nullptr ? sidecar->containsBatch(searchValues, found) : index.containsBatch(searchValues, found);
+        return std::unique_ptr<AnalysisResult>(new SearchResult(probes, static_cast<long long>(foundCount)));
+    }
+};
+
+// Class running registered analyzers concurrently and reporting their results in registration order
+class AnalyzerScheduler {
+    // Registered analyzer with its result once run
+    struct Entry {
+        std::string name;       // Name shown in the timing report
+        Analyzer* analyzer;     // Analyzer to run, not owned
+        std::unique_ptr<AnalysisResult> result;    // Result of analyze()
+        double seconds;         // Time spent in analyze()
+    };
+
+    std::vector<Entry> entries; // Analyzers in registration order
+    double wallSeconds;         // Time from the first start to the last finish
+
+public:
+    // Constructor starts with no analyzers
+    AnalyzerScheduler() : wallSeconds(0) {}
+
+    // Register an analyzer under a name, the analyzer must outlive the scheduler
+    void add(const std::string& name, Analyzer& analyzer) {
+        Entry entry;
+        entry.name = name;
+        entry.analyzer = &analyzer;
+        entry.seconds = 0;
+        entries.push_back(std::move(entry));
+    }
+
+    // Run every registered analyzer on the pool and wait for all of them
+    void run(ThreadPool& pool) {
+        auto start = std::chrono::steady_clock::now();
+        for (Entry& entry : entries) {
+            Entry* task = &entry;
+            pool.submit([task] {
+                auto taskStart = std::chrono::steady_clock::now();
+                try {
+                    task->result = task->analyzer->analyze();
+                }
+                catch (const std::exception& e) {
+                    task->result.reset(new ErrorResult(e.what()));
+                }
+                task->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - taskStart).count();
+            });
+        }
+        pool.wait();
+        wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Write the results in registration order
+    void writeResults(ResultWriter& writer) const {
+        for (const Entry& entry : entries) {
+            entry.result->writeTo(writer);
+        }
+    }
+
+    // Write the time spent in each analyzer and the wall-clock time of the run
+    void printTimes(std::ostream& out, size_t threads) const {
+        out << "\nAnalyzer times on " << threads << " thread" << (threads == 1 ? "" : "s") << "\n";
+        for (const Entry& entry : entries) {
+            out << "  " << std::left << std::setw(20) << entry.name << std::right
+                << std::fixed << std::setprecision(3) << std::setw(12) << entry.seconds * 1000 << " ms\n";
+        }
+        out << "  " << std::left << std::setw(20) << "Wall clock" << std::right
+            << std::fixed << std::setprecision(3) << std::setw(12) << wallSeconds * 1000 << " ms\n";
+        out.unsetf(std::ios::fixed);
+    }
+};
+
+// Base class for data analysis over values delivered one block at a time
+class BlockAnalyzer {
+public:
+    // Virtual destructor to ensure proper cleanup
+    virtual ~BlockAnalyzer() {}
+
+    // Consume the next block of values
+    virtual void consume(const int* block, int count) = 0;
+
+    // Report the results for all blocks consumed so far
+    virtual std::unique_ptr<AnalysisResult> analyze() = 0;
+};
+
+// Block analyzer for statistical measures that need no sorted data
+class BlockStatisticsAnalyzer : public BlockAnalyzer {
+    long long count;    // Number of values consumed
+    int min;            // Smallest value consumed
+    int max;            // Largest value consumed
+    double sum;         // Sum for mean calculation
+    WideHistogram frequencyMap; // Frequency of each value, as large as the values are distinct however small the blocks
+    std::unique_ptr<QuantileSketch> sketch; // Estimates the quantiles, or nullptr when they are not asked for
+    std::vector<double> fractions;  // Fractions of the values, ascending, whose quantiles the sketch reports
+
+public:
+    // Constructor starts with no values, estimating the quantiles at fractions, or at SKETCHED_QUANTILES without any,
+    // by a sketch of rank error quantileError drawing its choices from seed, unless quantileError is 0
+    explicit BlockStatisticsAnalyzer(double quantileError = 0, const std::vector<double>& fractions = std::vector<double>(),
+                                     uint64_t seed = 0)
+        : count(0), min(0), max(0), sum(0), fractions(fractions) {
+        if (quantileError > 0) {
+            sketch.reset(new QuantileSketch(quantileError, seed));
+        }
+        if (this->fractions.empty()) {
+            this->fractions.assign(std::begin(SKETCHED_QUANTILES), std::end(SKETCHED_QUANTILES));
+        }
+    }
+
+    // Consume method accumulates min, max, sum and frequencies
+    void consume(const int* block, int count) override {
+        ScopedTimer timer("BlockStatisticsAnalyzer::consume");
+        if (this->count == 0 && count > 0) {
+            min = max = block[0];
+        }
+        for (int i = 0; i < count; ++i) {
+            min = std::min(min, block[i]);
+            max = std::max(max, block[i]);
+            sum += block[i];
+            frequencyMap.add(block[i]);
+        }
+        if (sketch) {
+            sketch->add(block, count);
+        }
+        this->count += count;
+    }
+
+    // Analyze method reports the accumulated measures
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("BlockStatisticsAnalyzer::analyze");
+        std::unique_ptr<StatisticsResult> result(new StatisticsResult());
+        if (count == 0) return result;  // Handle empty input case
+
+        // Calculate mode
+        int mode = min;
+        uint64_t maxFrequency = 1;
+        frequencyMap.forEach([&](int value, uint64_t count) {
+            if (count > maxFrequency || (count == maxFrequency && value < mode)) {  // Ties go to the smallest value
+                maxFrequency = count;
+                mode = value;
+            }
+        });
+
+        result->count = count;
+        result->min = min;
+        result->max = max;
+        result->mean = sum / count;
+        result->mode = mode;
+        result->modeCount = maxFrequency;   // The exact median is not available when streaming
+        if (sketch) {
+            result->quantiles = sketch->quantiles(fractions.data(), fractions.size());
+            result->quantileError = sketch->getError();
+        }
+        return result;
+    }
+};
+
+// Block analyzer for detecting duplicated values
+class BlockDuplicateAnalyzer : public BlockAnalyzer {
+    WideHistogram countMap; // Occurrences of each value, unused when estimating, as large as the values are distinct
+    std::unique_ptr<HyperLogLog> sketch;    // Estimates the distinct values, or nullptr when duplicates are counted exactly
+
+public:
+    // Constructor starts with no values, estimating with a sketch of 2^distinctPrecision registers unless it is 0
+    explicit BlockDuplicateAnalyzer(int distinctPrecision = 0) {
+        if (distinctPrecision > 0) {
+            sketch.reset(new HyperLogLog(distinctPrecision));
+        }
+    }
+
+    // Consume method counts occurrences of each value, or adds them to the sketch
+    void consume(const int* block, int count) override {
+        ScopedTimer timer("BlockDuplicateAnalyzer::consume");
+        if (sketch) {
+            sketch->add(block, count);
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            countMap.add(block[i]);
+        }
+    }
+
+    // Analyze method counts duplicated values, or estimates them as the values less the distinct ones
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("BlockDuplicateAnalyzer::analyze");
+        if (sketch) {
+            std::unique_ptr<DuplicateResult> result(new DuplicateResult());
+            result->distinctCount = sketch->estimate();
+            result->duplicateCount = sketch->getCount() - result->distinctCount;
+            result->distinctError = sketch->getError();
+            return result;
+        }
+        long long duplicateCount = 0;
+        countMap.forEach([&](int, uint64_t count) {
+            duplicateCount += static_cast<long long>(count - 1);
+        });
+        return std::unique_ptr<AnalysisResult>(new DuplicateResult(duplicateCount));
+    }
+};
+
+// Block analyzer for detecting missing values
+class BlockMissingAnalyzer : public BlockAnalyzer {
+    PresenceBitset presence;    // Values of the domain seen so far
+
+public:
+    // Constructor expects values in [domainLow, domainHigh]
+    BlockMissingAnalyzer(long long domainLow = 0, long long domainHigh = DOMAIN_SIZE - 1) : presence(domainLow, domainHigh) {}
+
+    // Consume method records each value seen
+    void consume(const int* block, int count) override {
+        ScopedTimer timer("BlockMissingAnalyzer::consume");
+        for (int i = 0; i < count; ++i) {
+            presence.set(block[i]);
+        }
+    }
+
+    // Analyze method counts missing values and lists the ranges they form
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("BlockMissingAnalyzer::analyze");
+        return presence.summarize();
+    }
+};
+
+// Block analyzer for searching random values
+class BlockSearchAnalyzer : public BlockAnalyzer {
+    int probes;                     // Number of random values searched for
+    std::vector<int> keys;          // Distinct values searched for, ascending
+    std::vector<int> multiplicity;  // Number of probes drawing each key
+    std::vector<unsigned char> found;   // Whether each key has been seen
+    size_t unseen;                  // Number of keys not seen yet
+
+public:
+    // Constructor picks the random values in [domainLow, domainHigh] up front, since the data is never held at once,
+    // and sorts them into a small key set that every block is scanned against
+    BlockSearchAnalyzer(int probes = SEARCH_PROBES, uint64_t seed = 0, long long domainLow = 0, long long domainHigh = DOMAIN_SIZE - 1)
+        : probes(probes) {
+        std::vector<int> searchValues(probes);
+        RandomGenerator random(seed, SEARCH_STREAM);
+        ValueDistribution(Distribution::Uniform, domainLow, domainHigh, searchValues.size()).fill(searchValues.data(), searchValues.size(), 0, random);
+        std::sort(searchValues.begin(), searchValues.end());
+        for (size_t i = 0; i < searchValues.size(); ++i) {
+            if (keys.empty() || keys.back() != searchValues[i]) {
+                keys.push_back(searchValues[i]);
+                multiplicity.push_back(0);
+            }
+            multiplicity.back()++;
+        }
+        found.assign(keys.size(), 0);
+        unseen = keys.size();
+    }
+
+    // Consume method marks keys that occur in the block, stopping once every key has been seen
+    void consume(const int* block, int count) override {
+        ScopedTimer timer("BlockSearchAnalyzer::consume");
+        if (unseen == 0) {
+            return;
+        }
+        int lowest = keys.front();
+        int highest = keys.back();
+        for (int i = 0; i < count; ++i) {
+            int value = block[i];
+            if (value < lowest || value > highest) {
+                continue;
+            }
+            size_t key = static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), value) - keys.begin());
+            if (keys[key] == value && !found[key]) {
+                found[key] = 1;
+                if (--unseen == 0) {
+                    return;
+                }
+            }
+        }
+    }
+
+    // Analyze method counts the probes whose key was found
+    std::unique_ptr<AnalysisResult> analyze() override {
+        ScopedTimer timer("BlockSearchAnalyzer::analyze");
+        long long foundCount = 0;
+        for (size_t key = 0; key < keys.size(); ++key) {
+            if (found[key]) {
+                foundCount += multiplicity[key];
+            }
+        }
+        return std::unique_ptr<AnalysisResult>(new SearchResult(probes, foundCount));
+    }
+};
+
+// Class for reading binary data from file one block at a time
+class BlockReader {
+    std::ifstream inFile;   // Stream positioned at the next block
+    uint64_t size;          // Total number of values in the file
+    uint64_t remaining;     // Number of values not yet read
+    std::vector<int> block; // Buffer reused for every block
+    int blockSize;          // Number of values in the current block
+
+public:
+    // Constructor reads the header and sizes the block buffer to blockBytes
+    BlockReader(const std::string& name, size_t blockBytes) : inFile(name, std::ios::binary), size(0), remaining(0), blockSize(0) {
+        if (!inFile) {
+            throw std::runtime_error("Cannot open " + name);
+        }
+        FileHeader header;
+        header.read(inFile, name);  // Read header of either format version
+        size = header.count;
+        remaining = size;
+        block.resize(std::min<size_t>(std::max<size_t>(blockBytes / sizeof(int), 1), INT_MAX));
+    }
+
+    // Read the next block, returns false once every value has been read
+    bool next() {
+        ScopedTimer timer("BlockReader read");
+        blockSize = static_cast<int>(std::min<uint64_t>(block.size(), remaining));
+        if (blockSize == 0) {
+            return false;
+        }
+        inFile.read(reinterpret_cast<char*>(block.data()), blockSize * sizeof(int));
+        if (!inFile) {
+            throw std::runtime_error("Unexpected end of file while streaming");
+        }
+        remaining -= blockSize;
+        return true;
+    }
+
+    // Getter for values of the current block
+    const int* getBlock() const {
+        return block.data();
+    }
+
+    // Getter for size of the current block
+    int getBlockSize() const {
+        return blockSize;
+    }
+
+    // Getter for total number of values in the file
+    uint64_t getSize() const {
+        return size;
+    }
+};
+
+// Function to create a binary file with random data drawn from seed, in the version 1 format when legacy is set
+// and with a block statistics footer when footer is set
+void createBinaryFile(const std::string& name, int length, uint64_t seed, bool legacy, bool footer) {
+    std::vector<int> array(length); // Create vector to hold random values
+    RandomGenerator(seed, GENERATE_STREAM).fill(array.data(), array.size(), DOMAIN_SIZE);   // Generate random numbers in [0, DOMAIN_SIZE)
+    writeBinary(array.data(), length, name, legacy, footer);   // Write vector data to binary file
+}
+
+// Function to write data into a binary file, in the version 1 format when legacy is set,
+// followed by a block statistics footer when footer is set and the format is version 2
+void writeBinary(int* values, int length, const std::string& name, bool legacy, bool footer) {
+    std::ofstream outFile(name, std::ios::binary); // Open file in binary mode
+    if (!outFile) {
+        throw std::runtime_error("Cannot create " + name);
+    }
+    if (legacy) {
+        outFile.write(reinterpret_cast<const char*>(&length), sizeof(length));   // Write size of array
+    }
+    else {
+        FileHeader header;
+        header.count = static_cast<uint64_t>(length);
+        outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));   // Write header
+        std::vector<char> padding(static_cast<size_t>(header.payloadOffset) - sizeof(header), 0);
+        outFile.write(padding.data(), static_cast<std::streamsize>(padding.size()));   // Pad to the payload offset
+    }
+    outFile.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(length) * sizeof(int)); // Write array elements
+    if (footer && !legacy) {
+        StatisticsFooter statistics;
+        statistics.build(values, static_cast<uint64_t>(length));
+        statistics.write(outFile);  // Write block statistics after the array
+    }
+    outFile.close();    // Close file stream
+    if (!outFile) {
+        throw std::runtime_error("Cannot write " + name);
+    }
+}
+
+// Function to generate count values of a distribution over [low, high] into a version 2 file, or version 1 when legacy
+// is set, each of threads threads drawing a contiguous part from its own random stream and writing it in place, so a seed
+// and thread count repeat a file, followed by a block statistics footer when footer is set and the format is version 2
+void generateDataset(const std::string& name, uint64_t count, Distribution distribution, long long low, long long high,
+                     double zipfExponent, uint64_t seed, int threads, bool legacy, bool footer) {
+    if ((legacy || footer) && count > static_cast<uint64_t>(INT_MAX)) {
+        throw std::invalid_argument(std::string(legacy ? "A version 1 file" : "A file with a footer") + " holds at most "
+                                    + std::to_string(INT_MAX) + " values");
+    }
+
+    // Write the header and extend the file to its full length, so that every thread can write its part in place
+    FileHeader header;
+    header.count = count;
+    if (legacy) {
+        header.payloadOffset = sizeof(int);     // Values follow the length prefix
+    }
+    {
+        std::ofstream outFile(name, std::ios::binary | std::ios::trunc);
+        if (!outFile) {
+            throw std::runtime_error("Cannot create " + name);
+        }
+        if (legacy) {
+            int length = static_cast<int>(count);
+            outFile.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        }
+        else {
+            outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            std::vector<char> padding(static_cast<size_t>(header.payloadOffset) - sizeof(header), 0);
+            outFile.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        }
+        if (count > 0) {
+            outFile.seekp(static_cast<std::streamoff>(header.payloadOffset + count * sizeof(int) - 1), std::ios::beg);
+            outFile.put(0);
+        }
+        outFile.close();
+        if (!outFile) {
+            throw std::runtime_error("Cannot write " + name);
+        }
+    }
+
+    ValueDistribution values(distribution, low, high, count, zipfExponent);
+    int parts = static_cast<int>(std::max<uint64_t>(1, std::min<uint64_t>(static_cast<uint64_t>(threads), count / GENERATE_CHUNK_VALUES + 1)));
+    std::vector<std::string> errors(parts);
+    std::vector<std::thread> workers;
+    for (int part = 0; part < parts; ++part) {
+        workers.emplace_back([&, part] {
+            try {
+                uint64_t first = count * part / parts;
+                uint64_t last = count * (part + 1) / parts;
+                RandomGenerator random(seed, GENERATE_STREAM + part);
+                std::fstream outFile(name, std::ios::binary | std::ios::in | std::ios::out);
+                outFile.seekp(static_cast<std::streamoff>(header.payloadOffset + first * sizeof(int)), std::ios::beg);
+                std::vector<int> chunk(static_cast<size_t>(std::min<uint64_t>(GENERATE_CHUNK_VALUES, last - first)));
+                for (uint64_t next = first; next < last; next += chunk.size()) {
+                    size_t length = static_cast<size_t>(std::min<uint64_t>(chunk.size(), last - next));
+                    values.fill(chunk.data(), length, next, random);
+                    outFile.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(length * sizeof(int)));
+                }
+                outFile.close();
+                if (!outFile) {
+                    throw std::runtime_error("Cannot write " + name);
+                }
+            }
+            catch (const std::exception& e) {
+                errors[part] = e.what();
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::string& error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+
+    // Summarize the blocks once every part is in place, since the histogram buckets span the range of the whole file
+    if (footer && !legacy) {
+        StatisticsFooter statistics;
+        {
+            BinaryReader reader(name, true);
+            statistics.build(reader.getValues(), static_cast<uint64_t>(reader.getSize()));
+        }
+        std::ofstream outFile(name, std::ios::binary | std::ios::app);
+        statistics.write(outFile);  // Write block statistics after the array
+        outFile.close();
+        if (!outFile) {
+            throw std::runtime_error("Cannot write " + name);
+        }
+    }
+}
+
+// Function to list the files a batch path names: every regular file of a directory, or the files matching a
+// pattern whose last component holds * or ? wildcards, or else the path itself, sorted by name
+std::vector<std::string> list_batch_files(const std::string& path) {
+    size_t separator = path.find_last_of("/\\");
+    std::string directory = separator == std::string::npos ? "." : path.substr(0, separator);
+    std::string pattern = separator == std::string::npos ? path : path.substr(separator + 1);
+    std::string prefix = separator == std::string::npos ? "" : path.substr(0, separator + 1);
+    if (pattern.find_first_of("*?") == std::string::npos) {
+        // Without wildcards the path is either a directory to list in full or a single file
+        directory = path;
+        pattern = "*";
+        prefix = path + "/";
+    }
+
+    std::vector<std::string> files;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA((directory + "\\*").c_str(), &entry);
+    if (search == INVALID_HANDLE_VALUE) {
+        if (pattern == "*" && GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES) {
+            return std::vector<std::string>(1, path);
+        }
+        throw std::runtime_error("Cannot list " + directory);
+    }
+    do {
+        if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && wildcard_match(pattern.c_str(), entry.cFileName)) {
+            files.push_back(prefix + entry.cFileName);
+        }
+    } while (FindNextFileA(search, &entry));
+    FindClose(search);
+#else
+    DIR* listing = opendir(directory.c_str());
+    if (listing == nullptr) {
+        struct stat info;
+        if (pattern == "*" && stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            return std::vector<std::string>(1, path);
+        }
+        throw std::runtime_error("Cannot list " + directory);
+    }
+    while (struct dirent* entry = readdir(listing)) {
+        std::string name = prefix + entry->d_name;
+        struct stat info;
+        if (wildcard_match(pattern.c_str(), entry->d_name) && stat(name.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            files.push_back(name);
+        }
+    }
+    closedir(listing);
+#endif
+    // Leave out the sidecar indexes that --index writes next to the data files
+    files.erase(std::remove_if(files.begin(), files.end(), [](const std::string& name) {
+        return name.size() >= 4 && name.compare(name.size() - 4, 4, ".idx") == 0;
+    }), files.end());
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Function to read the files named by a manifest, one per line, skipping blank lines and lines starting with #
+std::vector<std::string> read_manifest(const std::string& name) {
+    std::ifstream manifest(name);
+    if (!manifest) {
+        throw std::runtime_error("Cannot open " + name);
+    }
+    std::vector<std::string> files;
+    std::string line;
+    while (std::getline(manifest, line)) {
+        size_t end = line.find_last_not_of(" \t\r");
+        line = end == std::string::npos ? "" : line.substr(0, end + 1);
+        if (!line.empty() && line[0] != '#') {
+            files.push_back(line);
+        }
+    }
+    return files;
+}
+
+// Function to match a name against a pattern where * matches any run of characters and ? any one character
+bool wildcard_match(const char* pattern, const char* name) {
+    const char* star = nullptr;     // Last * seen in the pattern
+    const char* resume = nullptr;   // Name position the last * is currently matched up to
+    while (*name != '\0') {
+        if (*pattern == '?' || (*pattern != '*' && *pattern == *name)) {
+            pattern++;
+            name++;
+        }
+        else if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        }
+        else if (star != nullptr) {
+            pattern = star + 1;     // Let the last * swallow one more character
+            name = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
+
+// Function to analyze many files in one process, each worker taking the next file, mapping it,
+// running every analyzer on it in turn and writing one result record per file in completion order.
+// A file named more than once is analyzed once, so that no two workers build its sidecar index together
+void analyzeBatch(const std::vector<std::string>& named, const Options& options, std::ostream& out, std::ostream& report) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> files;
+    std::unordered_set<std::string> seen;
+    for (const std::string& name : named) {
+        if (seen.insert(name).second) {
+            files.push_back(name);
+        }
+    }
+
+    std::atomic<size_t> nextFile(0);
+    std::atomic<size_t> failed(0);
+    std::mutex outMutex;
+    ThreadPool pool(static_cast<size_t>(options.threads));
+    for (size_t worker = 0; worker < pool.getSize(); ++worker) {
+        pool.submit([&] {
+            // Buffers reused for every file this worker takes, so their capacity is allocated once
+            std::vector<int> sorted;
+            std::ostringstream record;
+            std::unique_ptr<ResultWriter> writer = ResultWriter::create(options.format, record, true);
+
+            for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+                record.str("");
+                writer->beginSource(files[i]);
+                try {
+                    Dataset data(files[i], true, options.domainLow, options.domainHigh, &sorted);
+                    StatisticsAnalyzer sa(data, options.fused, 1, options.quantileError, options.selectQuantiles, options.quantileFractions,
+                                          options.seed);
+                    DuplicateAnalyzer da(data, options.fused, 1, options.distinctPrecision);
+                    MissingAnalyzer ma(data, options.fused);
+                    SidecarIndex searchIndex;
+                    if (options.useIndex) {
+                        searchIndex.openOrBuild(files[i]);
+                    }
+                    SearchAnalyzer ra(data, options.probes, options.useIndex ? &searchIndex : nullptr, options.seed);
+                    Analyzer* analyzers[] = { &sa, &da, &ma, &ra };
+                    for (Analyzer* analyzer : analyzers) {
+                        analyzer->analyze()->writeTo(*writer);
+                    }
+                }
+                catch (const std::exception& e) {
+                    writer->write(ErrorResult(e.what()));
+                    failed++;
+                }
+                writer->endSource();
+
+                std::lock_guard<std::mutex> lock(outMutex);
+                out << record.str();
+            }
+        });
+    }
+    pool.wait();
+    out.flush();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report << "Analyzed " << files.size() << " file" << (files.size() == 1 ? "" : "s") << ", " << failed << " failed, in "
+           << seconds << " s on " << pool.getSize() << " thread" << (pool.getSize() == 1 ? "" : "s") << "\n";
+}
+
+// Function to get the length and modification time of a file, the time in the finest unit the platform records
+void file_stamp(const std::string& name, unsigned long long& length, long long& modified) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(name.c_str(), GetFileExInfoStandard, &attributes)) {
+        throw std::runtime_error("Cannot get the attributes of " + name);
+    }
+    length = (static_cast<unsigned long long>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+    modified = static_cast<long long>((static_cast<unsigned long long>(attributes.ftLastWriteTime.dwHighDateTime) << 32)
+        | attributes.ftLastWriteTime.dwLowDateTime);    // 100 ns ticks
+#else
+    struct stat info;
+    if (stat(name.c_str(), &info) != 0) {
+        throw std::runtime_error("Cannot get the attributes of " + name);
+    }
+    length = static_cast<unsigned long long>(info.st_size);
+#if defined(__APPLE__)
+    modified = static_cast<long long>(info.st_mtimespec.tv_sec) * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    modified = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+#endif
+}
+
+// Function to compute the exact sum, min and max of array one element at a time,
+// giving sum 0, min INT_MAX and max INT_MIN for an empty array
+void sum_min_max_scalar(const int* values, int size, long long& sum, int& min, int& max) {
+    sum = 0;
+    min = INT_MAX;
+    max = INT_MIN;
+    for (int i = 0; i < size; ++i) {
+        sum += values[i];
+        min = std::min(min, values[i]);
+        max = std::max(max, values[i]);
+    }
+}
+
+#ifdef SIMD_X86
+// Function to compute the exact sum, min and max of array eight elements at a time,
+// widening each element to 64 bits before adding so the sum cannot overflow
+TARGET_AVX2 void sum_min_max_avx2(const int* values, int size, long long& sum, int& min, int& max) {
+    __m256i minimums = _mm256_set1_epi32(INT_MAX);
+    __m256i maximums = _mm256_set1_epi32(INT_MIN);
+    __m256i lowSums = _mm256_setzero_si256();
+    __m256i highSums = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        minimums = _mm256_min_epi32(minimums, block);
+        maximums = _mm256_max_epi32(maximums, block);
+        lowSums = _mm256_add_epi64(lowSums, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(block)));
+        highSums = _mm256_add_epi64(highSums, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(block, 1)));
+    }
+
+    // Reduce the lanes, then fold in the elements left over past the last full vector
+    alignas(32) int minLanes[8];
+    alignas(32) int maxLanes[8];
+    alignas(32) long long sumLanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(minLanes), minimums);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxLanes), maximums);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sumLanes), _mm256_add_epi64(lowSums, highSums));
+    sum_min_max_scalar(values + i, size - i, sum, min, max);
+    for (int lane = 0; lane < 8; ++lane) {
+        min = std::min(min, minLanes[lane]);
+        max = std::max(max, maxLanes[lane]);
+    }
+    for (int lane = 0; lane < 4; ++lane) {
+        sum += sumLanes[lane];
+    }
+}
+
+// GCC 12 warns that the undefined vectors its AVX-512 intrinsics start from may be used uninitialized,
+// though every lane of them is overwritten, so the warning is silenced for this kernel alone
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// Function to compute the exact sum, min and max of array sixteen elements at a time,
+// widening each element to 64 bits before adding so the sum cannot overflow
+TARGET_AVX512 void sum_min_max_avx512(const int* values, int size, long long& sum, int& min, int& max) {
+    __m512i minimums = _mm512_set1_epi32(INT_MAX);
+    __m512i maximums = _mm512_set1_epi32(INT_MIN);
+    __m512i lowSums = _mm512_setzero_si512();
+    __m512i highSums = _mm512_setzero_si512();
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m512i block = _mm512_loadu_si512(values + i);
+        minimums = _mm512_min_epi32(minimums, block);
+        maximums = _mm512_max_epi32(maximums, block);
+        lowSums = _mm512_add_epi64(lowSums, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(block)));
+        highSums = _mm512_add_epi64(highSums, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(block, 1)));
+    }
+
+    // Reduce the lanes, then fold in the elements left over past the last full vector
+    alignas(64) int minLanes[16];
+    alignas(64) int maxLanes[16];
+    alignas(64) long long sumLanes[8];
+    _mm512_store_si512(minLanes, minimums);
+    _mm512_store_si512(maxLanes, maximums);
+    _mm512_store_si512(sumLanes, _mm512_add_epi64(lowSums, highSums));
+    sum_min_max_scalar(values + i, size - i, sum, min, max);
+    for (int lane = 0; lane < 16; ++lane) {
+        min = std::min(min, minLanes[lane]);
+        max = std::max(max, maxLanes[lane]);
+    }
+    for (int lane = 0; lane < 8; ++lane) {
+        sum += sumLanes[lane];
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Function to check whether the processor and operating system support AVX2, and AVX-512 when wide is set
+bool cpu_supports(bool wide) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return wide ? __builtin_cpu_supports("avx512f") != 0 : __builtin_cpu_supports("avx2") != 0;
+#elif defined(_MSC_VER)
+    int registers[4];
+    __cpuid(registers, 1);
+    if ((registers[2] & (1 << 27)) == 0) {
+        return false;   // No OSXSAVE, so the operating system does not save the vector registers
+    }
+    unsigned long long enabled = _xgetbv(0);
+    unsigned long long needed = wide ? 0xE6 : 0x06;     // YMM state, plus opmask and ZMM state for AVX-512
+    if ((enabled & needed) != needed) {
+        return false;
+    }
+    __cpuidex(registers, 7, 0);
+    return (registers[1] & (wide ? (1 << 16) : (1 << 5))) != 0;
+#else
+    (void)wide;
+    return false;
+#endif
+}
+#endif
+
+// Function to compute the exact sum, min and max of array with the widest kernel the processor supports
+void sum_min_max(const int* values, int size, long long& sum, int& min, int& max) {
+    typedef void (*Kernel)(const int*, int, long long&, int&, int&);
+    static const Kernel kernel = [] {
+#ifdef SIMD_X86
+        if (cpu_supports(true)) {
+            return static_cast<Kernel>(sum_min_max_avx512);
+        }
+        if (cpu_supports(false)) {
+            return static_cast<Kernel>(sum_min_max_avx2);
+        }
+#endif
+        return static_cast<Kernel>(sum_min_max_scalar);
+    }();
+    kernel(values, size, sum, min, max);
+}
+
+// Function to perform selection sort on array
+void selection_sort(int* values, int size) {
+    for (int i = 0; i < size - 1; ++i) {
+        int minIndex = i;
+        for (int j = i + 1; j < size; ++j) {
+            if (values[j] < values[minIndex]) {
+                minIndex = j;
+            }
+        }
+        std::swap(values[i], values[minIndex]);    // Swap elements to sort
+    }
+}
+
+// Function to perform insertion sort on array, fastest for very small arrays
+void insertion_sort(int* values, int size) {
+    for (int i = 1; i < size; ++i) {
+        int value = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > value) {
+            values[j + 1] = values[j];
+            --j;
+        }
+        values[j + 1] = value;
+    }
+}
+
+// Function to perform counting sort on array whose values all lie in [min, max]
+void counting_sort(int* values, int size, int min, int max) {
+    std::vector<int> counts(static_cast<size_t>(static_cast<long long>(max) - min + 1), 0);
+    for (int i = 0; i < size; ++i) {
+        counts[static_cast<size_t>(static_cast<long long>(values[i]) - min)]++;
+    }
+    int index = 0;
+    for (size_t offset = 0; offset < counts.size(); ++offset) {
+        int value = static_cast<int>(min + static_cast<long long>(offset));
+        for (int count = counts[offset]; count > 0; --count) {
+            values[index++] = value;
+        }
+    }
+}
+
+// Function to perform LSD radix sort on array, one byte per pass
+void radix_sort(int* values, int size) {
+    std::vector<unsigned int> keys(size);
+    std::vector<unsigned int> scratch(size);
+    for (int i = 0; i < size; ++i) {
+        keys[i] = static_cast<unsigned int>(values[i]) ^ 0x80000000u;  // Flip sign bit so negatives order first
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t counts[257] = {};
+        for (int i = 0; i < size; ++i) {
+            counts[((keys[i] >> shift) & 0xFF) + 1]++;
+        }
+        if (counts[((keys[0] >> shift) & 0xFF) + 1] == static_cast<size_t>(size)) {
+            continue;   // Every key has the same byte here, so this pass would not move anything
+        }
+        for (int digit = 0; digit < 256; ++digit) {
+            counts[digit + 1] += counts[digit];
+        }
+        for (int i = 0; i < size; ++i) {
+            scratch[counts[(keys[i] >> shift) & 0xFF]++] = keys[i];
+        }
+        keys.swap(scratch);
+    }
+    for (int i = 0; i < size; ++i) {
+        values[i] = static_cast<int>(keys[i] ^ 0x80000000u);
+    }
+}
+
+// Function to sort array, picking the algorithm from the size and the observed value range
+void sort_values(int* values, int size) {
+    if (size <= INSERTION_SORT_MAX_SIZE) {
+        insertion_sort(values, size);
+        return;
+    }
+    int min = values[0];
+    int max = values[0];
+    for (int i = 1; i < size; ++i) {
+        min = std::min(min, values[i]);
+        max = std::max(max, values[i]);
+    }
+    long long range = static_cast<long long>(max) - min + 1;
+    if (range <= COUNTING_SORT_MAX_RANGE && range <= 4LL * size) {
+        counting_sort(values, size, min, max);  // O(n + k) while the counts stay small next to the data
+    }
+    else {
+        radix_sort(values, size);
+    }
+}
+
+// Function to move the value of zero-based rank rank into values[rank], with no larger value before it and no smaller one
+// after it, in O(n) expected time. Quickselect on a median-of-three pivot keeps only the side of each partition holding
+// rank, and falls back to sort_values when partitions stay unbalanced. The Hoare partition splits runs of equal values
+// down the middle, so few distinct values do not unbalance it
+void introselect(int* values, int size, int rank) {
+    int depth = 0;  // Partitions allowed before falling back, twice log2 of size
+    for (int remaining = size; remaining > 1; remaining >>= 1) {
+        depth += 2;
+    }
+    while (size > INSERTION_SORT_MAX_SIZE) {
+        if (depth-- == 0) {
+            sort_values(values, size);
+            return;
+        }
+        // Move the median of the first, middle and last values to the front, which keeps both sides of the partition
+        // non-empty
+        int middle = size / 2;
+        if (values[middle] < values[0]) {
+            std::swap(values[middle], values[0]);
+        }
+        if (values[size - 1] < values[middle]) {
+            std::swap(values[size - 1], values[middle]);
+            if (values[middle] < values[0]) {
+                std::swap(values[middle], values[0]);
+            }
+        }
+        std::swap(values[0], values[middle]);
+        int pivot = values[0];
+
+        // Values no larger than the pivot end in [0, split], values no smaller in (split, size)
+        int i = -1;
+        int split = size;
+        for (;;) {
+            do {
+                i++;
+            } while (values[i] < pivot);
+            do {
+                split--;
+            } while (values[split] > pivot);
+            if (i >= split) {
+                break;
+            }
+            std::swap(values[i], values[split]);
+        }
+        if (rank <= split) {
+            size = split + 1;
+        }
+        else {
+            values += split + 1;
+            size -= split + 1;
+            rank -= split + 1;
+        }
+    }
+    insertion_sort(values, size);
+}
+
+// Function to find the values at ascending zero-based ranks of array without sorting it, possibly reordering it.
+// Small value ranges are counted, as counting sort would, otherwise each rank is selected among the values at or after
+// the rank before it, which the previous selection left no smaller
+std::vector<int> select_ranks(int* values, int size, const std::vector<int>& ranks) {
+    std::vector<int> found;
+    if (size == 0) {
+        return found;
+    }
+    long long sum;
+    int min;
+    int max;
+    sum_min_max(values, size, sum, min, max);
+    long long range = static_cast<long long>(max) - min + 1;
+    if (size > INSERTION_SORT_MAX_SIZE && range <= COUNTING_SORT_MAX_RANGE && range <= 4LL * size) {
+        std::vector<int> counts(static_cast<size_t>(range), 0);
+        for (int i = 0; i < size; ++i) {
+            counts[static_cast<size_t>(static_cast<long long>(values[i]) - min)]++;
+        }
+        long long below = 0;    // Values smaller than the one at offset
+        size_t offset = 0;
+        for (int rank : ranks) {
+            while (below + counts[offset] <= rank) {
+                below += counts[offset++];
+            }
+            found.push_back(static_cast<int>(min + static_cast<long long>(offset)));
+        }
+        return found;
+    }
+
+    int first = 0;  // Values before the previous rank are no larger than it, so later ranks lie at or after it
+    for (int rank : ranks) {
+        introselect(values + first, size - first, rank - first);
+        found.push_back(values[rank]);
+        first = rank;
+    }
+    return found;
+}
+
+// Counting allocations replaces the global operator new of the whole program, so it is only built in with
+// COUNT_ALLOCATIONS defined, for profiling the benchmark suite. Only the plain and array forms are replaced: the
+// aligned forms of C++17 go uncounted, and nothing here allocates an over-aligned type
+#ifdef COUNT_ALLOCATIONS
+const bool ALLOCATIONS_COUNTED = true;  // Whether allocation_count() counts anything
+
+// Number of calls to operator new made by one thread, linked into a list of live threads that readers sum,
+// so that counting an allocation writes only a counter the thread owns instead of a shared atomic
+struct AllocationCounter {
+    std::atomic<unsigned long long> count;  // Allocations of the owning thread, written by it alone
+    AllocationCounter* next;                // Counter of the next live thread
+
+    AllocationCounter();
+    ~AllocationCounter();
+};
+
+std::mutex allocationCountersLock;                      // Guards the list of counters and their retirement
+AllocationCounter* allocationCounters = nullptr;        // Counters of the live threads
+std::atomic<unsigned long long> retiredAllocations(0);  // Allocations of threads that have exited
+thread_local bool allocationCounterRetired = false;     // Whether this thread's counter is already destroyed
+
+// Constructor links the counter of the calling thread into the list
+AllocationCounter::AllocationCounter() : count(0) {
+    std::lock_guard<std::mutex> lock(allocationCountersLock);
+    next = allocationCounters;
+    allocationCounters = this;
+}
+
+// Destructor unlinks the counter when its thread exits, keeping its allocations in the retired total
+AllocationCounter::~AllocationCounter() {
+    std::lock_guard<std::mutex> lock(allocationCountersLock);
+    for (AllocationCounter** link = &allocationCounters; *link != nullptr; link = &(*link)->next) {
+        if (*link == this) {
+            *link = next;
+            break;
+        }
+    }
+    retiredAllocations.fetch_add(count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    allocationCounterRetired = true;
+}
+
+// Function to get the number of calls to operator new since the program started, over every thread,
+// so benchmarks can report allocations
+unsigned long long allocation_count() {
+    std::lock_guard<std::mutex> lock(allocationCountersLock);
+    unsigned long long total = retiredAllocations.load(std::memory_order_relaxed);
+    for (const AllocationCounter* counter = allocationCounters; counter != nullptr; counter = counter->next) {
+        total += counter->count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// Replacement operator new counting each allocation in the counter of the calling thread
+void* operator new(size_t size) {
+    if (!allocationCounterRetired) {
+        thread_local AllocationCounter counter;
+        counter.count.store(counter.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    else {
+        retiredAllocations.fetch_add(1, std::memory_order_relaxed);    // Allocated by a destructor at thread exit
+    }
+    if (void* address = std::malloc(size == 0 ? 1 : size)) {
+        return address;
+    }
+    throw std::bad_alloc();
+}
+
+// Replacement operator new[] counting each allocation
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+// Replacement operator delete matching the counting operator new, kept out of line so that the compiler
+// does not pair the free() with an allocation it assumes came from the standard operator new
+NOINLINE void operator delete(void* address) noexcept {
+    std::free(address);
+}
+
+// Replacement operator delete[] matching the counting operator new[]
+NOINLINE void operator delete[](void* address) noexcept {
+    std::free(address);
+}
+
+// Replacement sized operator delete matching the counting operator new
+NOINLINE void operator delete(void* address, size_t) noexcept {
+    std::free(address);
+}
+
+// Replacement sized operator delete[] matching the counting operator new[]
+NOINLINE void operator delete[](void* address, size_t) noexcept {
+    std::free(address);
+}
+#else
+const bool ALLOCATIONS_COUNTED = false; // Whether allocation_count() counts anything
+
+// Function standing in for the allocation count when allocations are not counted
+unsigned long long allocation_count() {
+    return 0;
+}
+#endif
+
+// Function to name a distribution the way --distribution spells it
+const char* distribution_name(Distribution distribution) {
+    switch (distribution) {
+    case Distribution::Uniform:
+        return "uniform";
+    case Distribution::Normal:
+        return "normal";
+    case Distribution::Zipf:
+        return "zipf";
+    case Distribution::Sorted:
+        return "sorted";
+    case Distribution::ReverseSorted:
+        return "reverse-sorted";
+    case Distribution::FewDistinct:
+        return "few-distinct";
+    }
+    return "unknown";
+}
+
+// Function to time every sort, search, counting and I/O kernel over a matrix of sizes and distributions,
+// reporting ns per element, GB/s of input and, in COUNT_ALLOCATIONS builds, heap allocations per run
+void benchmarkSuite(const Options& options) {
+    const uint64_t sizes[] = { 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    const Distribution distributions[] = { Distribution::Uniform, Distribution::Normal, Distribution::Zipf,
+                                           Distribution::Sorted, Distribution::ReverseSorted, Distribution::FewDistinct };
+    const int quadraticMaxSize = 10000;     // Selection and insertion sort beyond this take too long to be worth timing
+    const std::string fileName = "benchmark.dat";
+
+    std::cout << "Benchmark over [" << options.domainLow << ", " << options.domainHigh << "], I/O through a warm page cache\n";
+    std::cout << std::left << std::setw(22) << "kernel" << std::setw(16) << "distribution" << std::right << std::setw(12) << "size"
+              << std::setw(12) << "ns/element" << std::setw(10) << "GB/s" << std::setw(10) << "allocs" << "\n";
+
+    // Run prepare then the kernel, repeating small runs until they add up to a measurable time, and print one row
+    auto measure = [](const std::string& kernel, Distribution distribution, uint64_t elements, uint64_t bytes,
+                      const std::function<void()>& prepare, const std::function<void()>& run) {
+        double seconds = 0;
+        unsigned long long allocations = 0;
+        int runs = 0;
+        do {
+            prepare();
+            unsigned long long allocationsBefore = allocation_count();
+            auto start = std::chrono::steady_clock::now();
+            run();
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            allocations += allocation_count() - allocationsBefore;
+            runs++;
+        } while (seconds < BENCHMARK_MIN_SECONDS && runs < 1000);
+
+        double perRun = seconds / runs;
+        std::cout << std::left << std::setw(22) << kernel << std::setw(16) << distribution_name(distribution) << std::right
+                  << std::setw(12) << elements << std::fixed << std::setprecision(2)
+                  << std::setw(12) << perRun * 1e9 / elements << std::setw(10) << bytes / perRun / 1e9
+                  << std::setw(10);
+        if (ALLOCATIONS_COUNTED) {
+            std::cout << static_cast<double>(allocations) / runs << "\n";
+        }
+        else {
+            std::cout << "-\n";
+        }
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << std::setprecision(6);
+    };
+    auto nothing = [] {};
+
+    for (uint64_t size64 : sizes) {
+        if (size64 > options.benchmarkMaxSize) {
+            break;
+        }
+        int size = static_cast<int>(size64);
+        uint64_t bytes = size64 * sizeof(int);
+        for (Distribution distribution : distributions) {
+            RandomGenerator random(options.seed, GENERATE_STREAM);
+            std::vector<int> input(size);
+            ValueDistribution(distribution, options.domainLow, options.domainHigh, size64, options.zipfExponent)
+                .fill(input.data(), input.size(), 0, random);
+            int min = *std::min_element(input.begin(), input.end());
+            int max = *std::max_element(input.begin(), input.end());
+            std::vector<int> work;
+            auto reset = [&] { work = input; };
+
+            // Sorts, each on a fresh copy of the input
+            if (size <= quadraticMaxSize) {
+                measure("selection_sort", distribution, size64, bytes, reset, [&] { selection_sort(work.data(), size); });
+                measure("insertion_sort", distribution, size64, bytes, reset, [&] { insertion_sort(work.data(), size); });
+            }
+            if (static_cast<long long>(max) - min + 1 <= COUNTING_SORT_MAX_RANGE) {
+                measure("counting_sort", distribution, size64, bytes, reset, [&] { counting_sort(work.data(), size, min, max); });
+            }
+            measure("radix_sort", distribution, size64, bytes, reset, [&] { radix_sort(work.data(), size); });
+            measure("std::sort", distribution, size64, bytes, reset, [&] { std::sort(work.data(), work.data() + size); });
+            measure("sort_values", distribution, size64, bytes, reset, [&] { sort_values(work.data(), size); });
+            measure("introselect median", distribution, size64, bytes, reset, [&] { introselect(work.data(), size, size / 2); });
+            measure("select_ranks median", distribution, size64, bytes, reset, [&] {
+                select_ranks(work.data(), size, std::vector<int>(1, size / 2));
+            });
+
+            // Searches for random keys of the domain, one at a time and in batches
+            std::vector<int> sorted = input;
+            sort_values(sorted.data(), size);
+            std::vector<int> keys(BENCHMARK_SEARCH_PROBES);
+            ValueDistribution(Distribution::Uniform, options.domainLow, options.domainHigh, keys.size())
+                .fill(keys.data(), keys.size(), 0, random);
+            uint64_t keyBytes = keys.size() * sizeof(int);
+            size_t found = 0;
+            measure("binary_search", distribution, keys.size(), keyBytes, nothing, [&] {
+                for (int key : keys) {
+                    found += binary_search(sorted.data(), size, key);
+                }
+            });
+            EytzingerIndex index(sorted.data(), sorted.size());
+            std::vector<unsigned char> hits;
+            measure("eytzinger_batch", distribution, keys.size(), keyBytes, nothing, [&] {
+                found += index.containsBatch(keys, hits);
+            });
+
+            // Frequency counting in a node-based map, a flat-array histogram and a histogram forced to hash
+            measure("unordered_map_count", distribution, size64, bytes, nothing, [&] {
+                std::unordered_map<int, uint32_t> counts;
+                for (int value : input) {
+                    counts[value]++;
+                }
+                found += counts.size();
+            });
+            measure("histogram_dense", distribution, size64, bytes, nothing, [&] {
+                Histogram counts;
+                for (int value : input) {
+                    counts.add(value);
+                }
+                found += counts.isHashed();
+            });
+            measure("histogram_hashed", distribution, size64, bytes, nothing, [&] {
+                Histogram counts(1);
+                for (int value : input) {
+                    counts.add(value);
+                }
+                found += counts.isHashed();
+            });
+
+            // File I/O, reading the file back whole, through a mapping and one block at a time
+            long long checksum = 0;
+            measure("writeBinary", distribution, size64, bytes, nothing, [&] {
+                writeBinary(input.data(), size, fileName);
+            });
+            measure("BinaryReader_read", distribution, size64, bytes, nothing, [&] {
+                BinaryReader reader(fileName);
+                checksum += reader.getValues()[size - 1];
+            });
+            measure("BinaryReader_mmap", distribution, size64, bytes, nothing, [&] {
+                BinaryReader reader(fileName, true);
+                for (int i = 0; i < reader.getSize(); ++i) {
+                    checksum += reader.getValues()[i];  // Touch every page, since mapping alone reads nothing
+                }
+            });
+            measure("BlockReader_stream", distribution, size64, bytes, nothing, [&] {
+                BlockReader reader(fileName, static_cast<size_t>(DEFAULT_BLOCK_MIB) << 20);
+                while (reader.next()) {
+                    checksum += reader.getBlock()[reader.getBlockSize() - 1];
+                }
+            });
+            std::remove(fileName.c_str());
+            if (found == 0 && checksum == 42) {
+                std::cout << "";    // Keep the results observable so the kernels are not optimized away
+            }
+        }
+    }
+}
+
+// Function to check the error of the distinct-count sketch against exact counts over a matrix of precisions and
+// cardinalities, each value added twice and the sketch built from two merged halves, returns whether every root
+// mean square relative error stays within DISTINCT_CHECK_TOLERANCE times the documented standard error
+bool checkDistinctSketch(uint64_t seed) {
+    const int precisions[] = { MIN_DISTINCT_PRECISION, 8, DEFAULT_DISTINCT_PRECISION, 16, MAX_DISTINCT_PRECISION };
+    const int cardinalities[] = { 1000, 10000, 100000, 1000000 };
+    RandomGenerator random(seed, SEARCH_STREAM);
+
+    std::cout << "Distinct-count sketch error against exact counts, seed " << seed << "\n";
+    std::cout << std::setw(10) << "precision" << std::setw(12) << "distinct" << std::setw(8) << "trials" << std::setw(12) << "rms error"
+              << std::setw(12) << "bound" << std::setw(8) << "" << "\n";
+    bool passed = true;
+    for (int precision : precisions) {
+        for (int cardinality : cardinalities) {
+            // Smaller cardinalities run more trials, since the error of few trials is too noisy to check
+            int trials = static_cast<int>(std::min<uint64_t>(DISTINCT_CHECK_MAX_TRIALS,
+                                                              std::max<uint64_t>(DISTINCT_CHECK_MIN_TRIALS, DISTINCT_CHECK_VALUES / cardinality)));
+            double squares = 0;
+            double bound = 0;
+            for (int trial = 0; trial < trials; ++trial) {
+                // A run of consecutive values from a random start holds exactly cardinality distinct values
+                std::vector<int> values(cardinality);
+                int start = static_cast<int>(static_cast<uint32_t>(random.next()));
+                for (int i = 0; i < cardinality; ++i) {
+                    values[i] = static_cast<int>(static_cast<uint32_t>(start) + static_cast<uint32_t>(i));
+                }
+                HyperLogLog sketch(precision);
+                HyperLogLog half(precision);
+                sketch.add(values.data(), cardinality / 2);
+                half.add(values.data() + cardinality / 2, cardinality - cardinality / 2);
+                sketch.merge(half);
+                sketch.add(values.data(), cardinality);     // Duplicates leave the estimate unchanged
+                double error = static_cast<double>(sketch.estimate() - cardinality) / cardinality;
+                squares += error * error;
+                bound = sketch.getError();
+            }
+            double rms = std::sqrt(squares / trials);
+            bool within = rms <= DISTINCT_CHECK_TOLERANCE * bound;
+            passed = passed && within;
+            std::cout << std::setw(10) << precision << std::setw(12) << cardinality << std::setw(8) << trials << std::fixed << std::setprecision(4)
+                      << std::setw(12) << rms << std::setw(12) << bound << std::setw(8) << (within ? "ok" : "FAIL") << "\n";
+            std::cout.unsetf(std::ios::fixed);
+            std::cout << std::setprecision(6);
+        }
+    }
+    return passed;
+}
+
+// Function to time each sort algorithm over a matrix of sizes and value ranges
+void benchmarkSorts() {
+    const int sizes[] = { 1000, 10000, 100000, 1000000, 10000000 };
+    const long long ranges[] = { 1000, 1LL << 16, 1LL << 24, 1LL << 32 };
+    const int selectionMaxSize = 10000;   // Selection sort beyond this takes too long to be worth timing
+    std::mt19937 generator(12345);
+
+    std::cout << "Sort benchmark in ns per element, '-' where an algorithm does not apply\n";
+    std::cout << std::setw(10) << "size" << std::setw(12) << "range"
+              << std::setw(12) << "selection" << std::setw(12) << "insertion" << std::setw(12) << "counting"
+              << std::setw(12) << "radix" << std::setw(12) << "std::sort" << std::setw(12) << "engine" << "\n";
+
+    for (int size : sizes) {
+        for (long long range : ranges) {
+            std::uniform_int_distribution<long long> distribution(0, range - 1);
+            std::vector<int> input(size);
+            for (int& value : input) {
+                value = static_cast<int>(distribution(generator) - range / 2);  // Center the range on zero
+            }
+            int min = *std::min_element(input.begin(), input.end());
+            int max = *std::max_element(input.begin(), input.end());
+
+            // Time one algorithm on a fresh copy of the input, in ns per element
+            std::vector<int> work;
+            auto timeSort = [&](void (*sort)(int*, int)) {
+                work = input;
+                auto start = std::chrono::steady_clock::now();
+                sort(work.data(), size);
+                auto stop = std::chrono::steady_clock::now();
+                return std::chrono::duration<double, std::nano>(stop - start).count() / size;
+            };
+            auto cell = [](bool applies, double nsPerElement) {
+                std::ostringstream text;
+                if (applies) {
+                    text << std::fixed << std::setprecision(2) << nsPerElement;
+                }
+                else {
+                    text << "-";
+                }
+                return text.str();
+            };
+
+            bool countingApplies = range <= COUNTING_SORT_MAX_RANGE;
+            double selection = size <= selectionMaxSize ? timeSort(selection_sort) : 0;
+            double insertion = size <= selectionMaxSize ? timeSort(insertion_sort) : 0;
+            double counting = 0;
+            if (countingApplies) {
+                work = input;
+                auto start = std::chrono::steady_clock::now();
+                counting_sort(work.data(), size, min, max);
+                auto stop = std::chrono::steady_clock::now();
+                counting = std::chrono::duration<double, std::nano>(stop - start).count() / size;
+            }
+            double radix = timeSort(radix_sort);
+            double standard = timeSort([](int* values, int size) { std::sort(values, values + size); });
+            double engine = timeSort(sort_values);
+
+            std::cout << std::setw(10) << size << std::setw(12) << range
+                      << std::setw(12) << cell(size <= selectionMaxSize, selection)
+                      << std::setw(12) << cell(size <= selectionMaxSize, insertion)
+                      << std::setw(12) << cell(countingApplies, counting)
+                      << std::setw(12) << cell(true, radix)
+                      << std::setw(12) << cell(true, standard)
+                      << std::setw(12) << cell(true, engine) << "\n";
+        }
+    }
+}
+
+// Recursive function for binary search
+bool binary_search_recursive(const int* values, int key, int start, int end) {
+    if (start > end) {
+        return false;
+    }
+    int mid = start + (end - start) / 2;
+    if (values[mid] == key) {
+        return true;
+    }
+    if (values[mid] > key) {
+        return binary_search_recursive(values, key, start, mid - 1);
+    }
+    return binary_search_recursive(values, key, mid + 1, end);
+}
+
+// Function to perform binary search on array
+bool binary_search(const int* values, int size, int key) {
+    return binary_search_recursive(values, key, 0, size - 1);
+}
+
+// Function to parse command-line options
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    options.mapped = false;
+    options.streamed = false;
+    options.blockMiB = DEFAULT_BLOCK_MIB;
+    options.benchmarkSort = false;
+    options.benchmark = false;
+    options.checkDistinct = false;
+    options.benchmarkMaxSize = BENCHMARK_DEFAULT_MAX_SIZE;
+    options.fused = false;
+    options.histogramBuckets = HISTOGRAM_MAX_BUCKETS;
+    options.domainLow = 0;
+    options.domainHigh = DOMAIN_SIZE - 1;
+    options.probes = SEARCH_PROBES;
+    options.threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    options.legacyFormat = false;
+    options.writeFooter = false;
+    options.summaryOnly = false;
+    options.countRange = false;
+    options.rangeLow = 0;
+    options.rangeHigh = 0;
+    options.useIndex = false;
+    options.searchOnly = false;
+    options.seed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    options.generateCount = 0;
+    options.distribution = Distribution::Uniform;
+    options.zipfExponent = DEFAULT_ZIPF_EXPONENT;
+    options.output = "binary.dat";
+    options.input = "";
+    options.format = ResultFormat::Text;
+    options.profile = false;
+    options.traceFile = "";
+    options.quantileError = 0;
+    options.selectQuantiles = false;
+    options.distinctPrecision = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--mmap") {
+            options.mapped = true;
+        }
+        else if (arg == "--benchmark-sort") {
+            options.benchmarkSort = true;
+        }
+        else if (arg == "--benchmark") {
+            options.benchmark = true;
+        }
+        else if (arg == "--check-distinct") {
+            options.checkDistinct = true;
+        }
+        else if (arg == "--benchmark-max-size" && i + 1 < argc) {
+            options.benchmarkMaxSize = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--fused") {
+            options.fused = true;
+        }
+        else if (arg == "--histogram-budget" && i + 1 < argc) {
+            options.histogramBuckets = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+            if (options.histogramBuckets == 0) {
+                throw std::invalid_argument("Histogram budget must be a positive number of buckets");
+            }
+        }
+        else if (arg == "--domain" && i + 1 < argc) {
+            std::string domain = argv[++i];
+            size_t separator = domain.find(':');
+            if (separator == std::string::npos) {
+                throw std::invalid_argument("Domain must be given as low:high");
+            }
+            options.domainLow = std::stoll(domain.substr(0, separator));
+            options.domainHigh = std::stoll(domain.substr(separator + 1));
+            if (options.domainLow > options.domainHigh || options.domainLow < INT_MIN || options.domainHigh > INT_MAX) {
+                throw std::invalid_argument("Domain must satisfy INT_MIN <= low <= high <= INT_MAX");
+            }
+        }
+        else if (arg == "--probes" && i + 1 < argc) {
+            options.probes = std::atoi(argv[++i]);
+            if (options.probes < 0) {
+                throw std::invalid_argument("Number of probes must not be negative");
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+            if (options.threads <= 0) {
+                throw std::invalid_argument("Number of threads must be positive");
+            }
+        }
+        else if (arg == "--legacy-format") {
+            options.legacyFormat = true;
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--generate" && i + 1 < argc) {
+            options.generateCount = std::strtoull(argv[++i], nullptr, 10);
+            if (options.generateCount == 0) {
+                throw std::invalid_argument("Number of values to generate must be positive");
+            }
+        }
+        else if (arg == "--distribution" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "uniform") {
+                options.distribution = Distribution::Uniform;
+            }
+            else if (name == "normal") {
+                options.distribution = Distribution::Normal;
+            }
+            else if (name == "zipf") {
+                options.distribution = Distribution::Zipf;
+            }
+            else if (name == "sorted") {
+                options.distribution = Distribution::Sorted;
+            }
+            else if (name == "reverse-sorted") {
+                options.distribution = Distribution::ReverseSorted;
+            }
+            else if (name == "few-distinct") {
+                options.distribution = Distribution::FewDistinct;
+            }
+            else {
+                throw std::invalid_argument("Unknown distribution " + name);
+            }
+        }
+        else if (arg == "--zipf-exponent" && i + 1 < argc) {
+            options.zipfExponent = std::atof(argv[++i]);
+            if (!(options.zipfExponent > 0)) {
+                throw std::invalid_argument("Zipf exponent must be positive");
+            }
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            options.output = argv[++i];
+        }
+        else if (arg == "--input" && i + 1 < argc) {
+            options.input = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "text") {
+                options.format = ResultFormat::Text;
+            }
+            else if (name == "json") {
+                options.format = ResultFormat::Json;
+            }
+            else if (name == "binary") {
+                options.format = ResultFormat::Binary;
+            }
+            else {
+                throw std::invalid_argument("Unknown result format " + name);
+            }
+        }
+        else if (arg == "--batch" && i + 1 < argc) {
+            std::vector<std::string> files = list_batch_files(argv[++i]);
+            options.batchFiles.insert(options.batchFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--manifest" && i + 1 < argc) {
+            std::vector<std::string> files = read_manifest(argv[++i]);
+            options.batchFiles.insert(options.batchFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--index") {
+            options.useIndex = true;
+        }
+        else if (arg == "--search-only") {
+            options.searchOnly = true;
+        }
+        else if (arg == "--footer") {
+            options.writeFooter = true;
+        }
+        else if (arg == "--summary") {
+            options.summaryOnly = true;
+        }
+        else if (arg == "--count-range" && i + 1 < argc) {
+            std::string range = argv[++i];
+            size_t separator = range.find(':');
+            if (separator == std::string::npos) {
+                throw std::invalid_argument("Range must be given as low:high");
+            }
+            long long low = std::stoll(range.substr(0, separator));
+            long long high = std::stoll(range.substr(separator + 1));
+            if (low > high || low < INT_MIN || high > INT_MAX) {
+                throw std::invalid_argument("Range must satisfy INT_MIN <= low <= high <= INT_MAX");
+            }
+            options.countRange = true;
+            options.rangeLow = static_cast<int>(low);
+            options.rangeHigh = static_cast<int>(high);
+        }
+        else if (arg == "--profile") {
+            options.profile = true;
+        }
+        else if (arg == "--quantile-sketch") {
+            options.quantileError = DEFAULT_QUANTILE_ERROR;
+        }
+        else if (arg == "--quantile-error" && i + 1 < argc) {
+            options.quantileError = std::atof(argv[++i]);
+            if (!(options.quantileError > 0 && options.quantileError < 1)) {
+                throw std::invalid_argument("Quantile error must lie between 0 and 1");
+            }
+        }
+        else if (arg == "--distinct-sketch") {
+            options.distinctPrecision = DEFAULT_DISTINCT_PRECISION;
+        }
+        else if (arg == "--distinct-precision" && i + 1 < argc) {
+            options.distinctPrecision = std::atoi(argv[++i]);
+            if (options.distinctPrecision < MIN_DISTINCT_PRECISION || options.distinctPrecision > MAX_DISTINCT_PRECISION) {
+                throw std::invalid_argument("Distinct precision must lie between " + std::to_string(MIN_DISTINCT_PRECISION) + " and "
+                                            + std::to_string(MAX_DISTINCT_PRECISION) + " bits");
+            }
+        }
+        else if (arg == "--select") {
+            options.selectQuantiles = true;
+        }
+        else if (arg == "--percentiles" && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string percentile;
+            while (std::getline(list, percentile, ',')) {
+                double fraction = std::atof(percentile.c_str()) / 100;
+                if (percentile.empty() || !(fraction >= 0 && fraction <= 1)) {
+                    throw std::invalid_argument("Percentiles must be given as a comma-separated list of numbers in [0, 100]");
+                }
+                options.quantileFractions.push_back(fraction);
+            }
+            std::sort(options.quantileFractions.begin(), options.quantileFractions.end());
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            options.traceFile = argv[++i];
+        }
+        else if (arg == "--stream") {
+            options.streamed = true;
+        }
+        else if (arg == "--block-size" && i + 1 < argc) {
+            options.blockMiB = std::atoi(argv[++i]);
+            if (options.blockMiB <= 0) {
+                throw std::invalid_argument("Block size must be a positive number of MiB");
+            }
+        }
+        else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    if (options.writeFooter && options.legacyFormat) {
+        throw std::invalid_argument("A statistics footer needs the version 2 format, it cannot be combined with --legacy-format");
+    }
+    if (options.selectQuantiles && !options.useIndex) {
+        throw std::invalid_argument("--select only saves time when no analyzer sorts the values, so it needs --index to search "
+                                    "the sidecar index instead of a sorted copy");
+    }
+    if (!options.batchFiles.empty() && (options.streamed || options.searchOnly || options.summaryOnly || options.countRange)) {
+        throw std::invalid_argument("--batch and --manifest run every analyzer on each file in memory, they cannot be combined "
+                                    "with --stream, --search-only, --summary or --count-range");
+    }
+    if (options.selectQuantiles && options.quantileError > 0) {
+        throw std::invalid_argument("--select finds exact quantiles, it cannot be combined with a quantile sketch");
+    }
+    return options;
+}
+
+// Function to print the profile and write the trace of the run, when asked for
+void finishInstrumentation(const Options& options, std::ostream& report) {
+    if (options.profile) {
+        profiler.print(report);
+    }
+    if (!options.traceFile.empty()) {
+        tracer.write(options.traceFile);
+        report << "Wrote trace to " << options.traceFile << "\n";
+    }
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+    try {
+        Options options = parseOptions(argc, argv);
+        Histogram::defaultMaxBuckets = options.histogramBuckets;
+        if (options.profile) {
+            profiler.enable();
+        }
+        if (!options.traceFile.empty()) {
+            tracer.enable();
+            tracer.threadNumber();  // Number the main thread 0
+        }
+
+        // Program introduction, left out of machine-readable results, which go to standard output alone
+        if (options.format == ResultFormat::Text) {
+            std::cout << "Binary Data Analyzer\n" << "\n";
+        }
+        else if (options.format == ResultFormat::Binary) {
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);   // Keep newline bytes in records from being translated
+#endif
+        }
+        std::ostream& report = options.format == ResultFormat::Text ? std::cout : std::cerr;  // Stream for timings
+        std::unique_ptr<ResultWriter> writer = ResultWriter::create(options.format, std::cout);
+
+        if (options.benchmarkSort) {
+            benchmarkSorts();
+            return 0;
+        }
+
+        if (options.benchmark) {
+            benchmarkSuite(options);
+            return 0;
+        }
+
+        if (options.checkDistinct) {
+            return checkDistinctSketch(options.seed) ? 0 : 1;
+        }
+
+        if (options.generateCount > 0) {
+            auto start = std::chrono::steady_clock::now();
+            generateDataset(options.output, options.generateCount, options.distribution, options.domainLow, options.domainHigh,
+                            options.zipfExponent, options.seed, options.threads, options.legacyFormat, options.writeFooter);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Wrote " << options.generateCount << " values to " << options.output << " in " << seconds << " s\n";
+            return 0;
+        }
+
+        if (!options.batchFiles.empty()) {
+            analyzeBatch(options.batchFiles, options, std::cout, report);
+            finishInstrumentation(options, report);
+            return 0;
+        }
+
+        // Analyze the file named on the command line, or create the binary file when none is.
+        // A footer query reads an existing file and never regenerates it
+        bool queryFooter = options.summaryOnly || options.countRange;
+        std::string fileName = options.input.empty() ? "binary.dat" : options.input;
+        if (options.input.empty() && !queryFooter) {
+            createBinaryFile(fileName, SIZE, options.seed, options.legacyFormat, options.writeFooter);
+        }
+
+        if (queryFooter) {
+            // Answer from the footer, touching only the payload blocks a range count cannot rule out
+            BinaryReader reader(fileName, true);
+            StatisticsFooter footer;
+            if (!footer.read(fileName, reader.getHeader())) {
+                throw std::runtime_error(fileName + " has no statistics footer, write it with --footer");
+            }
+            writer->beginSource(fileName);
+            if (options.summaryOnly) {
+                FooterSummaryResult summary;
+                footer.summarize(summary);
+                summary.writeTo(*writer);
+            }
+            if (options.countRange) {
+                RangeCountResult range(options.rangeLow, options.rangeHigh);
+                range.foundCount = footer.countInRange(reader.getValues(), options.rangeLow, options.rangeHigh, range.blocksScanned);
+                range.blockCount = footer.getBlockCount();
+                range.writeTo(*writer);
+            }
+            writer->endSource();
+            return 0;
+        }
+
+        if (options.searchOnly) {
+            // Answer the lookups from the mapped sidecar index, loading the values only when there is none
+            SidecarIndex searchIndex;
+            std::unique_ptr<Dataset> data;
+            std::unique_ptr<SearchAnalyzer> ra;
+            if (options.useIndex) {
+                searchIndex.openOrBuild(fileName);
+                ra.reset(new SearchAnalyzer(searchIndex, options.probes, options.seed, options.domainLow, options.domainHigh));
+            }
+            else {
+                data.reset(new Dataset(fileName, options.mapped, options.domainLow, options.domainHigh));
+                ra.reset(new SearchAnalyzer(*data, options.probes, nullptr, options.seed));
+            }
+            writer->beginSource(fileName);
+            ra->analyze()->writeTo(*writer);
+            writer->endSource();
+            finishInstrumentation(options, report);
+            return 0;
+        }
 
-    // Create the binary file
-    createBinaryFile("binary.dat", SIZE);
+        if (options.streamed) {
+            // Feed every block to each analyzer in turn, so only one block of values is held in memory. The mode, and
+            // the duplicates unless they are estimated, still keep a count per distinct value: memory grows with the
+            // distinct values of the stream, whatever the block size and histogram budget
+            BlockStatisticsAnalyzer sa(options.quantileError, options.quantileFractions, options.seed);
+            BlockDuplicateAnalyzer da(options.distinctPrecision);
+            BlockMissingAnalyzer ma(options.domainLow, options.domainHigh);
+            BlockSearchAnalyzer ra(options.probes, options.seed, options.domainLow, options.domainHigh);
+            BlockAnalyzer* analyzers[] = { &sa, &da, &ma, &ra };
 
-    // Create a BinaryReader instance
-    BinaryReader br("binary.dat");
+            BlockReader reader(fileName, static_cast<size_t>(options.blockMiB) << 20);
+            while (reader.next()) {
+                for (BlockAnalyzer* analyzer : analyzers) {
+                    analyzer->consume(reader.getBlock(), reader.getBlockSize());
+                }
+            }
+            writer->beginSource(fileName);
+            for (BlockAnalyzer* analyzer : analyzers) {
+                analyzer->analyze()->writeTo(*writer);
+            }
+            writer->endSource();
+            finishInstrumentation(options, report);
+            return 0;
+        }
 
-    // Create an instance of the StatisticsAnalyzer class
-    StatisticsAnalyzer sa(br.getValues(), br.getSize());
-    std::cout << sa.analyze() << '\n';
+        // Create a Dataset instance shared by every analyzer
+        Dataset data(fileName, options.mapped, options.domainLow, options.domainHigh);
 
-    // Create an instance of the DuplicateAnalyzer class
-    DuplicateAnalyzer da(br.getValues(), br.getSize());
-    std::cout << da.analyze() << '\n';
+        // Create an instance of each analyzer, sharing the sorted view and fused pass of the dataset
+        StatisticsAnalyzer sa(data, options.fused, options.threads, options.quantileError, options.selectQuantiles,
+                              options.quantileFractions, options.seed);
+        DuplicateAnalyzer da(data, options.fused, options.threads, options.distinctPrecision);
+        MissingAnalyzer ma(data, options.fused);
+        SidecarIndex searchIndex;
+        if (options.useIndex) {
+            searchIndex.openOrBuild(fileName);
+        }
+        SearchAnalyzer ra(data, options.probes, options.useIndex ? &searchIndex : nullptr, options.seed);
 
-    // Create an instance of the MissingAnalyzer class
-    MissingAnalyzer ma(br.getValues(), br.getSize());
-    std::cout << ma.analyze() << '\n';
+        // Run the analyzers concurrently, then print their results in a fixed order
+        AnalyzerScheduler scheduler;
+        scheduler.add("StatisticsAnalyzer", sa);
+        scheduler.add("DuplicateAnalyzer", da);
+        scheduler.add("MissingAnalyzer", ma);
+        scheduler.add("SearchAnalyzer", ra);
 
-    // Create an instance of the SearchAnalyzer class
-    SearchAnalyzer ra(br.getValues(), br.getSize());
-    std::cout << ra.analyze() << '\n';
+        ThreadPool pool(options.threads);
+        scheduler.run(pool);
+        writer->beginSource(fileName);
+        scheduler.writeResults(*writer);
+        writer->endSource();
+        scheduler.printTimes(report, pool.getSize());
+        finishInstrumentation(options, report);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
 
     return 0;
 }
\ No newline at end of file